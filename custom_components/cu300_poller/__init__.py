@@ -12,10 +12,16 @@ from .const import (
     DOMAIN,
     CONNECTION_TYPE_SERIAL,
     CONNECTION_TYPE_TCP,
+    CONF_EMBEDDED_MODEL,
+    CONF_RECORD_SESSION,
     CONF_UPDATE_INTERVAL,
     DEFAULT_UPDATE_INTERVAL,
+    EMBEDDED_MODEL_NONE,
 )
 from .coordinator import CU300Coordinator
+from .genibus.devices.db import DeviceDB
+from .genibus.reconcile import reconcileFleet
+from .genibus.utils.trace import tracer
 
 _LOGGER = logging.getLogger(__name__)
 
@@ -43,6 +49,24 @@ SERVICE_SET_REFERENCE_SCHEMA = vol.Schema(
     }
 )
 
+SERVICE_APPLY_PROFILE_SCHEMA = vol.Schema(
+    {
+        vol.Required("parameters"): vol.Schema(
+            {cv.string: vol.All(vol.Coerce(int), vol.Range(min=0, max=255))}
+        ),
+        vol.Optional("dry_run", default=False): cv.boolean,
+    }
+)
+
+SERVICE_DUMP_TRACE_SCHEMA = vol.Schema(
+    {
+        # A bare file name: the trace always lands in the configuration directory.
+        vol.Optional("filename", default="cu300_trace.json"): vol.All(
+            cv.string, vol.Match(r"^(?!\.)[\w.-]+\Z", msg="filename must be a plain file name")
+        ),
+    }
+)
+
 
 async def async_setup(hass: HomeAssistant, config: dict) -> bool:
     """Set up the CU300 Poller integration from YAML."""
@@ -72,6 +96,12 @@ async def async_setup_entry(hass: HomeAssistant, entry: ConfigEntry) -> bool:
     host = entry.data.get(CONF_HOST)
     port = entry.data.get(CONF_PORT)
     update_interval = entry.data.get(CONF_UPDATE_INTERVAL, DEFAULT_UPDATE_INTERVAL)
+    record_path = (
+        hass.config.path(f"{DOMAIN}_{entry.entry_id}.session")
+        if entry.options.get(CONF_RECORD_SESSION)
+        else None
+    )
+    embedded_model = entry.options.get(CONF_EMBEDDED_MODEL, EMBEDDED_MODEL_NONE)
 
     # Create coordinator
     coordinator = CU300Coordinator(
@@ -80,31 +110,40 @@ async def async_setup_entry(hass: HomeAssistant, entry: ConfigEntry) -> bool:
         host=host,
         port=port,
         update_interval=update_interval,
+        entry_id=entry.entry_id,
+        record_path=record_path,
+        embedded_model=None if embedded_model == EMBEDDED_MODEL_NONE else embedded_model,
     )
 
-    # Set up connection
+    # Set up from the persisted state; entities show the last-known values, marked stale
     try:
         await coordinator.async_setup()
     except ConfigEntryNotReady as err:
         _LOGGER.error("Failed to set up CU300: %s", err)
         raise
 
-    # Perform initial data fetch
-    await coordinator.async_config_entry_first_refresh()
-
     # Store coordinator
     hass.data.setdefault(DOMAIN, {})
     hass.data[DOMAIN][entry.entry_id] = coordinator
 
+    # Changed options (e.g. session recording) take effect through a reload
+    entry.async_on_unload(entry.add_update_listener(async_reload_entry))
+
     # Set up platforms
     await hass.config_entries.async_forward_entry_setups(entry, PLATFORMS)
 
+    # Connect and poll in the background, so a slow or absent unit doesn't hold up startup
+    entry.async_create_background_task(
+        hass, coordinator.async_start(), f"{DOMAIN}_start_{entry.entry_id}"
+    )
+
     # Register services
     async def handle_start_pump(call: ServiceCall) -> None:
         """Handle start pump service call."""
         _LOGGER.debug("Service call: start_pump")
         try:
-            await coordinator.async_start_pump()
+            with tracer.transaction("start_pump"):
+                await coordinator.async_start_pump()
         except Exception as err:
             _LOGGER.error("Failed to start pump: %s", err)
 
@@ -112,7 +151,8 @@ async def async_setup_entry(hass: HomeAssistant, entry: ConfigEntry) -> bool:
         """Handle stop pump service call."""
         _LOGGER.debug("Service call: stop_pump")
         try:
-            await coordinator.async_stop_pump()
+            with tracer.transaction("stop_pump"):
+                await coordinator.async_stop_pump()
         except Exception as err:
             _LOGGER.error("Failed to stop pump: %s", err)
 
@@ -121,10 +161,60 @@ async def async_setup_entry(hass: HomeAssistant, entry: ConfigEntry) -> bool:
         reference = call.data["reference"]
         _LOGGER.debug("Service call: set_reference to %s", reference)
         try:
-            await coordinator.async_set_reference(reference)
+            with tracer.transaction("set_reference", reference=reference):
+                await coordinator.async_set_reference(reference)
         except Exception as err:
             _LOGGER.error("Failed to set reference: %s", err)
 
+    async def handle_apply_profile(call: ServiceCall) -> None:
+        """Handle apply profile service call: reconcile every connected unit in parallel."""
+        profile = call.data["parameters"]
+        dry_run = call.data["dry_run"]
+        coordinators = [
+            coordinator
+            for coordinator in hass.data[DOMAIN].values()
+            if isinstance(coordinator, CU300Coordinator) and coordinator.connected
+        ]
+        _LOGGER.debug("Service call: apply_profile %s to %d units", profile, len(coordinators))
+        with tracer.transaction("apply_profile", units=len(coordinators)):
+            results = await reconcileFleet(
+                [coordinator.reconciler for coordinator in coordinators], profile, dry_run
+            )
+        for coordinator, result in zip(coordinators, results):
+            name = coordinator.port or coordinator.host
+            if isinstance(result, Exception):
+                _LOGGER.error("Failed to apply profile to %s: %s", name, result)
+                continue
+            if not dry_run:
+                coordinator.static.invalidate([change.name for change in result.changes])
+            _LOGGER.info(
+                "Profile %s %s: %s%s",
+                "check of" if dry_run else "applied to",
+                name,
+                ", ".join(f"{c.name} {c.current} -> {c.desired}" for c in result.changes) or "no changes",
+                f" (not confirmed: {', '.join(result.failed)})" if result.failed else "",
+            )
+
+    async def handle_dump_trace(call: ServiceCall) -> None:
+        """Handle dump trace service call."""
+        path = hass.config.path(call.data["filename"])
+        count = await hass.async_add_executor_job(tracer.export, path)
+        _LOGGER.info("Wrote %d trace events to %s", count, path)
+
+    async def handle_reload_catalog(call: ServiceCall) -> None:
+        """Handle reload catalog service call: publish a new device catalog version, polling carries on."""
+        db = DeviceDB()
+        try:
+            catalog = await hass.async_add_executor_job(db.loadCatalog)
+        except (OSError, ValueError) as err:
+            _LOGGER.error("Failed to reload device catalog, keeping version %s: %s", db.version, err)
+            return
+        version = db.publish(catalog)
+        for entry_coordinator in hass.data[DOMAIN].values():
+            if isinstance(entry_coordinator, CU300Coordinator):
+                entry_coordinator.async_catalog_reloaded()
+        _LOGGER.info("Device catalog version %s published (models: %s)", version, ", ".join(catalog.models))
+
     # Register services (only once)
     if not hass.services.has_service(DOMAIN, "start_pump"):
         hass.services.async_register(DOMAIN, "start_pump", handle_start_pump)
@@ -135,6 +225,19 @@ async def async_setup_entry(hass: HomeAssistant, entry: ConfigEntry) -> bool:
             handle_set_reference,
             schema=SERVICE_SET_REFERENCE_SCHEMA,
         )
+        hass.services.async_register(
+            DOMAIN,
+            "apply_profile",
+            handle_apply_profile,
+            schema=SERVICE_APPLY_PROFILE_SCHEMA,
+        )
+        hass.services.async_register(
+            DOMAIN,
+            "dump_trace",
+            handle_dump_trace,
+            schema=SERVICE_DUMP_TRACE_SCHEMA,
+        )
+        hass.services.async_register(DOMAIN, "reload_catalog", handle_reload_catalog)
 
     _LOGGER.info("CU300 Poller setup completed successfully")
     return True
@@ -160,6 +263,9 @@ async def async_unload_entry(hass: HomeAssistant, entry: ConfigEntry) -> bool:
             hass.services.async_remove(DOMAIN, "start_pump")
             hass.services.async_remove(DOMAIN, "stop_pump")
             hass.services.async_remove(DOMAIN, "set_reference")
+            hass.services.async_remove(DOMAIN, "apply_profile")
+            hass.services.async_remove(DOMAIN, "dump_trace")
+            hass.services.async_remove(DOMAIN, "reload_catalog")
 
     return unload_ok
 
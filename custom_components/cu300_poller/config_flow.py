@@ -17,10 +17,14 @@ from .const import (
     DOMAIN,
     CONNECTION_TYPE_SERIAL,
     CONNECTION_TYPE_TCP,
+    CONF_EMBEDDED_MODEL,
+    CONF_RECORD_SESSION,
     CONF_UPDATE_INTERVAL,
     DEFAULT_UPDATE_INTERVAL,
     DEFAULT_TCP_PORT,
+    EMBEDDED_MODEL_NONE,
 )
+from .genibus.devices.db import DeviceDB
 
 _LOGGER = logging.getLogger(__name__)
 
@@ -252,6 +256,14 @@ class CU300OptionsFlow(config_entries.OptionsFlow):
                             ),
                         ),
                     ): cv.positive_int,
+                    vol.Optional(
+                        CONF_RECORD_SESSION,
+                        default=self.config_entry.options.get(CONF_RECORD_SESSION, False),
+                    ): cv.boolean,
+                    vol.Optional(
+                        CONF_EMBEDDED_MODEL,
+                        default=self.config_entry.options.get(CONF_EMBEDDED_MODEL, EMBEDDED_MODEL_NONE),
+                    ): vol.In([EMBEDDED_MODEL_NONE, *DeviceDB().catalog.models]),
                 }
             ),
         )
@@ -10,12 +10,19 @@ CONNECTION_TYPE_TCP = "tcp"
 CONF_UPDATE_INTERVAL = "update_interval"
 CONF_DEVICE_ADDRESS = "device_address"
 CONF_SOURCE_ADDRESS = "source_address"
+CONF_RECORD_SESSION = "record_session"
+CONF_EMBEDDED_MODEL = "embedded_model"
 
 # Default values
 DEFAULT_UPDATE_INTERVAL = 30  # seconds
 DEFAULT_DEVICE_ADDRESS = 0x20
 DEFAULT_SOURCE_ADDRESS = 0x04
 DEFAULT_TCP_PORT = 502
+EMBEDDED_MODEL_NONE = "none"
+
+# Events
+EVENT_ALARM = f"{DOMAIN}_alarm"
+EVENT_THRESHOLD = f"{DOMAIN}_threshold"
 
 # Attributes
 ATTR_REFERENCE = "reference"
@@ -1,19 +1,33 @@
 """Data update coordinator for CU300 Poller."""
 import asyncio
 import logging
+import time
+from collections import Counter
 from datetime import timedelta
-from typing import Any
+from typing import Any, Callable
 
-from homeassistant.core import HomeAssistant
+from homeassistant.core import HomeAssistant, callback
+from homeassistant.helpers.storage import Store
 from homeassistant.helpers.update_coordinator import DataUpdateCoordinator, UpdateFailed
 from homeassistant.exceptions import ConfigEntryNotReady
 
-from .const import DOMAIN
-from .genibus.protocol import CU300Protocol
-from .genibus.exceptions import ProtocolError, ConnectionError as CU300ConnectionError
+from .const import DOMAIN, EVENT_ALARM, EVENT_THRESHOLD
+from .genibus.protocol import CU300Protocol, DATA_KEYS, EMBEDDED_PREFIX
+from .genibus.reconcile import Reconciler
+from .genibus.datamanager.derived import DerivedEngine, SCALED_INPUTS
+from .genibus.datamanager.alarms import AlarmHistory, INDICATORS as ALARM_INDICATORS
+from .genibus.datamanager.snapshot import Snapshot
+from .genibus.datamanager.static import StaticCache, isStatic
+from .genibus.datamanager.stats import StatsEngine
+from .genibus.devices.db import DeviceDB
+from .genibus.exceptions import GENIBusError, ProtocolError, ConnectionError as CU300ConnectionError
+from .genibus.utils.trace import tracer
 
 _LOGGER = logging.getLogger(__name__)
 
+STORAGE_VERSION = 1
+STATIC_SAVE_DELAY = 10
+
 class CU300Coordinator(DataUpdateCoordinator):
     """Coordinator to manage CU300 data updates."""
 
@@ -24,6 +38,9 @@ class CU300Coordinator(DataUpdateCoordinator):
         host: str | None = None,
         port: str | None = None,
         update_interval: int = 30,
+        entry_id: str | None = None,
+        record_path: str | None = None,
+        embedded_model: str | None = None,
     ) -> None:
         """Initialize the coordinator."""
         super().__init__(
@@ -35,33 +52,97 @@ class CU300Coordinator(DataUpdateCoordinator):
         self.connection_type = connection_type
         self.host = host
         self.port = port
+        # Session file every bus transaction is appended to, if set.
+        self.record_path = record_path
+        # Catalog model of the unit behind the CU300, read through class 9 tunnelling; None to leave it out.
+        self.embedded_model = embedded_model
         self.protocol: CU300Protocol | None = None
+        self.reconciler: Reconciler | None = None
         self._reconnect_task: asyncio.Task | None = None
         self._connected = False
+        # The alarm indicators are always polled; they trigger the alarm log fetch.
+        self._datapoint_users: Counter[str] = Counter(ALARM_INDICATORS)
+        # Poll values are raw bytes; metrics with units wait for the unit's scaling information.
+        self.derived = DerivedEngine(requireScales=True)
+        self.alarm_history = AlarmHistory()
+        self._entry_id = entry_id
+        self._stats_key = entry_id or DOMAIN
+        self.stats = StatsEngine([self._stats_key])
+        self.static = StaticCache()
+        self._static_names: set[str] = set()
+        self._store = Store(hass, STORAGE_VERSION, f"{DOMAIN}.{entry_id}.static") if entry_id else None
+        self._snapshot = (
+            Snapshot(hass.config.path(".storage", f"{DOMAIN}.{entry_id}.snapshot")) if entry_id else None
+        )
+        # The data are the last-known values of the previous run until the first poll succeeds.
+        self.stale = False
+        # Device model the platforms built their entities for.
+        self._entity_model: str | None = None
+        # Resize of the snapshot file in the executor, while one is under way.
+        self._snapshot_task: asyncio.Future | None = None
 
     async def async_setup(self) -> None:
-        """Set up the coordinator and establish connection."""
+        """Set up the coordinator from the persisted state; nothing here waits for the unit.
+
+        The connection and first poll are made by `async_start()`, in the background.
+        """
+        if self._store is not None:
+            self.static.load(await self._store.async_load())
+
         try:
             self.protocol = CU300Protocol(
                 connection_type=self.connection_type,
                 host=self.host,
                 port=self.port,
+                record_path=self.record_path,
             )
+        except Exception as err:
+            _LOGGER.error("Unexpected error during setup: %s", err)
+            raise ConfigEntryNotReady(f"Setup failed: {err}") from err
+        self.reconciler = Reconciler(self.protocol)
+
+        snapshot = None
+        if self._snapshot is not None:
+            snapshot = await self.hass.async_add_executor_job(self._snapshot.load)
+            # Mapped here, so saving from the event loop is only a copy into memory.
+            try:
+                await self.hass.async_add_executor_job(self._snapshot.open)
+            except OSError as err:
+                _LOGGER.warning("Failed to open the values snapshot: %s", err)
+        if snapshot is not None:
+            values, meta, saved = snapshot
+            # The unit of the last run selects the model, so the platforms build its entities.
+            self.protocol.adopt_identity(meta.get("identity", {}))
+            self.data = {**values, **self.static.values}
+            self.stale = True
+            _LOGGER.info("Warm start from the values of %s", time.strftime("%Y-%m-%d %H:%M:%S", time.localtime(saved)))
+        self._update_datapoints()
+        self._entity_model = self.protocol.model
+
+    async def async_start(self) -> None:
+        """Connect and poll for the first time; runs in the background of the entry setup."""
+        await self._async_connect()
+        await self.async_refresh()
+
+    async def _async_connect(self) -> None:
+        """First connection; failing, the next update retries with a reconnect."""
+        try:
             await asyncio.wait_for(self.protocol.connect(), timeout=15)
+            # The connect reply selected the device model; the static split depends on it.
+            self._update_datapoints()
+            self._check_model()
             self._connected = True
+            await self._async_read_scales()
             _LOGGER.info(
                 "Successfully connected to CU300 at %s",
                 self.port or f"{self.host}:{self.port}",
             )
-        except asyncio.TimeoutError as err:
+        except asyncio.TimeoutError:
             _LOGGER.error("Connection to CU300 timed out")
-            raise ConfigEntryNotReady("Connection timed out") from err
         except CU300ConnectionError as err:
             _LOGGER.error("Failed to connect to CU300: %s", err)
-            raise ConfigEntryNotReady(f"Connection failed: {err}") from err
         except Exception as err:
-            _LOGGER.error("Unexpected error during setup: %s", err)
-            raise ConfigEntryNotReady(f"Setup failed: {err}") from err
+            _LOGGER.error("Unexpected error during connect: %s", err)
 
     async def _async_update_data(self) -> dict[str, Any]:
         """Fetch data from CU300."""
@@ -72,11 +153,21 @@ class CU300Coordinator(DataUpdateCoordinator):
                 raise UpdateFailed("Not connected to CU300")
 
         try:
-            data = await asyncio.wait_for(
-                self.protocol.poll_data(),
-                timeout=10,
-            )
+            with tracer.transaction("poll"):
+                data = await asyncio.wait_for(
+                    self.protocol.poll_data(),
+                    timeout=10,
+                )
+            data.update(self.derived.update(time.monotonic(), data))
+            self._update_stats(data)
+            if self.alarm_history.changed(data):
+                data.update(await self._async_fetch_alarm_log(data))
+            data.update(await self._async_poll_embedded())
+            await self._async_refresh_static()
+            data.update(self.static.values)
             _LOGGER.debug("Successfully polled data: %s", data)
+            self.stale = False
+            self._save_snapshot(data)
             return data
 
         except asyncio.TimeoutError:
@@ -99,6 +190,147 @@ class CU300Coordinator(DataUpdateCoordinator):
             _LOGGER.exception("Unexpected error polling data")
             raise UpdateFailed(f"Unexpected error: {err}")
 
+    async def _async_refresh_static(self) -> None:
+        """Read the static datapoints that are not validated since the last (re)connect or SET.
+
+        A failed read keeps the cached values and the poll's data; the names stay unvalidated, so the next poll retries.
+        """
+        missing = self.static.missing(self._static_names)
+        if not missing:
+            return
+        try:
+            with tracer.span("static", count=len(missing)):
+                values = await asyncio.wait_for(self.protocol.read_datapoints(missing), timeout=10)
+        except (asyncio.TimeoutError, GENIBusError) as err:
+            _LOGGER.warning("Failed to read static datapoints: %s", err)
+            return
+        self.static.store(missing, values)
+        if self._store is not None:
+            self._store.async_delay_save(self.static.dump, STATIC_SAVE_DELAY)
+
+    async def _async_read_scales(self) -> None:
+        """Scale the inputs of the derived metrics from the unit's INFO replies.
+
+        Metrics whose inputs stay unscaled are not computed rather than published from raw bytes.
+        """
+        raw_names = {raw: name for raw, name in DATA_KEYS.items() if name in SCALED_INPUTS}
+        self.derived.clearScales()
+        try:
+            with tracer.span("scales"):
+                scales = await asyncio.wait_for(self.protocol.read_scales(list(raw_names)), timeout=10)
+        except (asyncio.TimeoutError, GENIBusError) as err:
+            _LOGGER.warning("Failed to read scaling information, derived metrics are not computed: %s", err)
+            return
+        for raw, (factor, offset, unit) in scales.items():
+            if not self.derived.setScale(raw_names[raw], factor, offset, unit):
+                _LOGGER.warning("Unit '%s' of %s is not supported by the derived metrics", unit, raw_names[raw])
+
+    def _check_model(self) -> None:
+        """Reload the entry once the unit turns out to be of another model than the entities were built for.
+
+        The snapshot takes the new identity first, so the reload builds the entities of the new model.
+        """
+        if self._entity_model is None or self.protocol.model == self._entity_model or self._entry_id is None:
+            return
+        _LOGGER.info(
+            "Device model changed from '%s' to '%s', reloading to rebuild the entities",
+            self._entity_model,
+            self.protocol.model,
+        )
+        self._entity_model = self.protocol.model
+        self.hass.async_create_task(self._async_reload_for_model())
+
+    async def _async_reload_for_model(self) -> None:
+        await self._async_flush_snapshot()
+        self._save_snapshot(self.data or {})
+        await self._async_flush_snapshot()
+        await self.hass.config_entries.async_reload(self._entry_id)
+
+    async def _async_flush_snapshot(self) -> None:
+        """Wait for a resize of the snapshot file under way."""
+        if self._snapshot_task is not None:
+            await self._snapshot_task
+
+    def _save_snapshot(self, data: dict[str, Any]) -> None:
+        """Persist the last-known values; a copy into the mapped file, cheap enough for the event loop.
+
+        Should the values outgrow the file, it is resized in the executor; saves meanwhile are skipped.
+        """
+        if self._snapshot is None or self._snapshot_task is not None:
+            return
+        identity = {key: value for key, value in self.protocol.identity.items() if isinstance(value, (int, float, str))}
+        payload = self._snapshot.encode(data, {"identity": identity})
+        if not self._snapshot.fits(payload):
+            self._snapshot_task = self.hass.async_add_executor_job(self._grow_snapshot, payload)
+            self._snapshot_task.add_done_callback(self._snapshot_grown)
+            return
+        try:
+            self._snapshot.write(payload)
+        except (OSError, ValueError) as err:
+            _LOGGER.warning("Failed to save the values snapshot: %s", err)
+
+    def _grow_snapshot(self, payload: bytes) -> None:
+        """Map the snapshot file large enough for `payload` and write it; runs in the executor."""
+        try:
+            self._snapshot.open(len(payload))
+            self._snapshot.write(payload)
+        except (OSError, ValueError) as err:
+            _LOGGER.warning("Failed to save the values snapshot: %s", err)
+
+    @callback
+    def _snapshot_grown(self, future: asyncio.Future) -> None:
+        self._snapshot_task = None
+
+    def _update_stats(self, data: dict[str, Any]) -> None:
+        """Fold the poll into the streaming statistics and fire an event per threshold crossing."""
+        self.stats.load(self._stats_key, data)
+        for event in self.stats.sweep():
+            _LOGGER.info("Threshold event: %s", event)
+            self.hass.bus.async_fire(EVENT_THRESHOLD, event._asdict())
+
+    async def _async_fetch_alarm_log(self, indicators: dict[str, Any]) -> dict[str, Any]:
+        """Fetch the alarm log after an indicator changed and fire an event per new alarm.
+
+        A failed fetch leaves the indicators unacknowledged, so it is retried next poll.
+        """
+        try:
+            with tracer.span("alarm_log"):
+                values = await asyncio.wait_for(self.protocol.poll_alarm_log(), timeout=10)
+        except (asyncio.TimeoutError, ProtocolError) as err:
+            _LOGGER.warning("Failed to fetch alarm log: %s", err)
+            return {}
+        for event in self.alarm_history.update(time.time(), indicators, values):
+            _LOGGER.info("Alarm event: %s", event)
+            self.hass.bus.async_fire(EVENT_ALARM, event._asdict())
+        return values
+
+    @property
+    def embedded_keys(self) -> dict[str, str]:
+        """Raw name -> published key of the embedded unit's values (the DATA_KEYS it has as plain datapoints)."""
+        if self.embedded_model is None:
+            return {}
+        db = DeviceDB()
+        return {
+            raw: f"{EMBEDDED_PREFIX}{name}"
+            for raw, name in DATA_KEYS.items()
+            if db.dataitemByClassAndName(self.embedded_model, raw)
+        }
+
+    async def _async_poll_embedded(self) -> dict[str, Any]:
+        """Values of the embedded unit; a failed read leaves them out of this poll only."""
+        keys = self.embedded_keys
+        if not keys:
+            return {}
+        try:
+            with tracer.span("embedded", count=len(keys)):
+                values = await asyncio.wait_for(
+                    self.protocol.poll_embedded(list(keys), self.embedded_model), timeout=10
+                )
+        except (asyncio.TimeoutError, GENIBusError) as err:
+            _LOGGER.warning("Failed to read the embedded unit: %s", err)
+            return {}
+        return {keys[raw]: value for raw, value in values.items() if raw in keys}
+
     async def _async_reconnect(self) -> None:
         """Attempt to reconnect to the device."""
         if self.protocol is None:
@@ -107,7 +339,11 @@ class CU300Coordinator(DataUpdateCoordinator):
         try:
             _LOGGER.info("Attempting to reconnect to CU300")
             await asyncio.wait_for(self.protocol.reconnect(), timeout=15)
+            self.static.invalidate()
+            self._update_datapoints()
+            self._check_model()
             self._connected = True
+            await self._async_read_scales()
             _LOGGER.info("Successfully reconnected to CU300")
         except Exception as err:
             _LOGGER.error("Failed to reconnect: %s", err)
@@ -136,16 +372,20 @@ class CU300Coordinator(DataUpdateCoordinator):
             except Exception as err:
                 _LOGGER.error("Error disconnecting: %s", err)
 
+        if self._snapshot is not None:
+            await self._async_flush_snapshot()
+            self._snapshot.close()
+
     async def async_start_pump(self) -> None:
         """Start the pump."""
         if not self._connected or self.protocol is None:
             raise UpdateFailed("Not connected to CU300")
 
         try:
-            await asyncio.wait_for(self.protocol.start_pump(), timeout=5)
+            with tracer.span("start_pump"):
+                readback = await asyncio.wait_for(self.protocol.start_pump(), timeout=5)
             _LOGGER.info("Pump started successfully")
-            # Request immediate update
-            await self.async_request_refresh()
+            self._merge_readback(readback)
         except Exception as err:
             _LOGGER.error("Failed to start pump: %s", err)
             raise UpdateFailed(f"Failed to start pump: {err}")
@@ -156,10 +396,10 @@ class CU300Coordinator(DataUpdateCoordinator):
             raise UpdateFailed("Not connected to CU300")
 
         try:
-            await asyncio.wait_for(self.protocol.stop_pump(), timeout=5)
+            with tracer.span("stop_pump"):
+                readback = await asyncio.wait_for(self.protocol.stop_pump(), timeout=5)
             _LOGGER.info("Pump stopped successfully")
-            # Request immediate update
-            await self.async_request_refresh()
+            self._merge_readback(readback)
         except Exception as err:
             _LOGGER.error("Failed to stop pump: %s", err)
             raise UpdateFailed(f"Failed to stop pump: {err}")
@@ -170,18 +410,65 @@ class CU300Coordinator(DataUpdateCoordinator):
             raise UpdateFailed("Not connected to CU300")
 
         try:
-            await asyncio.wait_for(
-                self.protocol.set_reference(value),
-                timeout=5,
-            )
+            with tracer.span("set_reference"):
+                readback = await asyncio.wait_for(
+                    self.protocol.set_reference(value),
+                    timeout=5,
+                )
             _LOGGER.info("Reference set to %s successfully", value)
-            # Request immediate update
-            await self.async_request_refresh()
+            self._merge_readback(readback)
         except Exception as err:
             _LOGGER.error("Failed to set reference: %s", err)
             raise UpdateFailed(f"Failed to set reference: {err}")
 
+    @callback
+    def async_catalog_reloaded(self) -> None:
+        """Re-split polled and static datapoints for a new catalog version; static values are read again.
+
+        The request plans notice the new version themselves and are recompiled on their next use.
+        """
+        self.static.invalidate()
+        self._update_datapoints()
+
+    @callback
+    def async_register_datapoint(self, name: str) -> Callable[[], None]:
+        """Poll `name` for as long as at least one enabled entity needs it.
+
+        Returns the function that drops the registration again.
+        """
+        self._datapoint_users[name] += 1
+        self._update_datapoints()
+
+        @callback
+        def unregister() -> None:
+            self._datapoint_users[name] -= 1
+            if self._datapoint_users[name] <= 0:
+                del self._datapoint_users[name]
+            self._update_datapoints()
+
+        return unregister
+
+    def _update_datapoints(self) -> None:
+        """Hand the polled datapoints to the protocol; static ones go to the static tier instead."""
+        if self.protocol is not None:
+            model = self.protocol.model
+            self._static_names = {name for name in self._datapoint_users if isStatic(model, name)}
+            self.protocol.set_datapoints(set(self._datapoint_users) - self._static_names)
+
+    def _merge_readback(self, readback: dict[str, Any]) -> None:
+        """Merge values read back with a command into the current state, no full poll needed."""
+        if not readback:
+            return
+        data = {**(self.data or {}), **readback}
+        self._save_snapshot(data)
+        self.async_set_updated_data(data)
+
     @property
     def connected(self) -> bool:
         """Return connection status."""
         return self._connected
+
+    @property
+    def available(self) -> bool:
+        """Whether entities show the data: polled on this connection, or warm-start values awaiting the first poll."""
+        return self.last_update_success and (self._connected or self.stale)
@@ -28,8 +28,10 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 import logging
 
-from .devices.db import DeviceDB
+from .devices.db import DeviceDB, DEFAULT_MODEL
 from . import gbdefs as defs
+from .composite import COMPOSITES, Layout
+from .exceptions import InvalidFrameError
 from .utils import crc
 from .utils.classes import BaseObject
 
@@ -45,33 +47,153 @@ class APDU(BaseObject):
         self._device_db = DeviceDB()
 
     @classmethod
-    def from_bytes(cls, data):
+    def from_bytes(cls, data, request, model = DEFAULT_MODEL):
         apdu = cls()
         apdu._raw = data
         apdu._data = {}
-        # Simplified parsing (adapt from GENIBus library)
         if not crc.check_tel(data, silent=True):
             logger.error("Invalid CRC in APDU response")
             return None
-        # Example parsing: map response to data items (head, flow, etc.)
-        di = db.dataitemsByClass("magna", defs.APDUClass.MEASURED_DATA)
-        offset = 4  # Skip header
-        for item_name, item in di.items():
-            if offset + 1 < len(data):
-                value = data[offset]  # Simplified; adjust based on actual format
-                apdu._data[item_name] = value
-                offset += 1
+        apdu._data = decodeReply(request, data, model)
         return apdu
 
     def get_value(self, key):
         return self._data.get(key)
 
+    def items(self):
+        return self._data.items()
+
+SIXTEENBIT_CLASSES = (
+    defs.APDUClass.SIXTEENBIT_MEASURED_DATA,
+    defs.APDUClass.SIXTEENBIT_CONFIGURATION_PARAMETERS,
+    defs.APDUClass.SIXTEENBIT_REFERENCE_VALUES,
+)
+
+def iterAPDUs(data, offset = 0, end = None):
+    """Yield (class, operation-or-acknowledge, data) for every APDU in data[offset:end]."""
+    end = len(data) if end is None else end
+    while offset + 2 <= end:
+        klass = data[offset]
+        length = data[offset + 1] & 0x3F
+        if offset + 2 + length > end:
+            raise InvalidFrameError("APDU exceeds telegram length")
+        yield klass, data[offset + 1] >> 6, data[offset + 2 : offset + 2 + length]
+        offset += 2 + length
+
+def splitAPDUs(telegram):
+    """Yield (class, operation-or-acknowledge, data) for every APDU of a complete telegram."""
+    return iterAPDUs(telegram, defs.PDU_START, len(telegram) - 2)
+
+def decodeAPDUs(requestAPDUs, replyAPDUs, model = DEFAULT_MODEL):
+    """Map the values of reply APDUs to the datapoint names of the request APDUs they answer.
+
+    APDUs in a reply appear in the same order as in the request; only GET
+    APDUs carry data (one byte per ID, two for the 16-bit classes, a string
+    for ASCII strings). Embedded PDUs are left to decodeEmbeddedReply().
+    """
+    result = {}
+    for (klass, op, ids), (replyKlass, ack, data) in zip(requestAPDUs, replyAPDUs):
+        if replyKlass != klass:
+            raise InvalidFrameError("Reply class {0} does not match request class {1}".format(replyKlass, klass))
+        if ack != defs.Acknowledge.OK:
+            logger.warning("Class {0} request not acknowledged: {1}".format(klass, defs.Acknowledge(ack).name))
+            continue
+        if op != defs.Operation.GET or klass == defs.APDUClass.EMBEDDED_PUDS:
+            continue
+        names = {item.id: name for name, item in (db.dataitemsByClass(model, klass) or {}).items()}
+        if klass == defs.APDUClass.ASCII_STRINGS:
+            result[names.get(ids[0], ids[0])] = bytes(data).split(b'\x00')[0].decode('ascii', 'replace')
+            continue
+        width = 2 if klass in SIXTEENBIT_CLASSES else 1
+        for idx, ident in enumerate(ids):
+            value = data[idx * width : (idx + 1) * width]
+            if len(value) < width:
+                break
+            result[names.get(ident, ident)] = value[0] if width == 1 else (value[0] << 8) | value[1]
+    return result
+
+def decodeReply(request, reply, model = DEFAULT_MODEL):
+    """Map the values of a reply telegram to the datapoint names of the request it answers."""
+    return decodeAPDUs(splitAPDUs(request), splitAPDUs(reply), model)
+
+def decodeEmbeddedReply(request, reply, model):
+    """Demultiplex the inner replies of all class 9 APDUs of a telegram.
+
+    `model` is the catalog model of the unit behind the tunnel.
+    """
+    result = {}
+    for (klass, _, inner), (replyKlass, ack, replyInner) in zip(splitAPDUs(request), splitAPDUs(reply)):
+        if klass != defs.APDUClass.EMBEDDED_PUDS or replyKlass != klass:
+            continue
+        if ack != defs.Acknowledge.OK:
+            logger.warning("Embedded PDU not acknowledged: {0}".format(defs.Acknowledge(ack).name))
+            continue
+        result.update(decodeAPDUs(iterAPDUs(inner), iterAPDUs(replyInner), model))
+    return result
+
+def decodeInfoReply(request, reply, model = DEFAULT_MODEL):
+    """Map the scaling information of an INFO reply to datapoint names (name -> gbdefs.Info).
+
+    Per ID the unit answers an info head; scaled values (SIF 2) add unit
+    index, zero and range, extended ones (SIF 3) unit index and a 16-bit zero,
+    returned as `zero` with `range` None. Without scaling information unit,
+    zero and range are None.
+    """
+    result = {}
+    for (klass, op, ids), (replyKlass, ack, data) in zip(splitAPDUs(request), splitAPDUs(reply)):
+        if replyKlass != klass:
+            raise InvalidFrameError("Reply class {0} does not match request class {1}".format(replyKlass, klass))
+        if ack != defs.Acknowledge.OK:
+            logger.warning("Class {0} INFO not acknowledged: {1}".format(klass, defs.Acknowledge(ack).name))
+            continue
+        if op != defs.Operation.INFO:
+            continue
+        names = {item.id: name for name, item in (db.dataitemsByClass(model, klass) or {}).items()}
+        pos = 0
+        for ident in ids:
+            if pos >= len(data):
+                break
+            head = data[pos]
+            sif = head & 0x03
+            if sif in (2, 3):
+                if pos + 4 > len(data):
+                    break
+                unit = data[pos + 1]
+                if sif == 2:
+                    info = defs.Info(head, unit, data[pos + 2], data[pos + 3])
+                else:
+                    info = defs.Info(head, unit, (data[pos + 2] << 8) | data[pos + 3], None)
+                pos += 4
+            else:
+                info = defs.Info(head, None, None, None)
+                pos += 1
+            result[names.get(ident, ident)] = info
+    return result
+
+def infoScale(info, units):
+    """(factor, offset, unit) turning raw values into physical ones, None if `info` carries no scaling.
+
+    `units` are the rows of the unit table, db.units(). Bit 7 of the unit
+    byte is the sign of the zero.
+    """
+    if info.unit is None:
+        return None
+    table = dict((row[0], row) for row in units)
+    row = table.get(info.unit & 0x7f)
+    if row is None:
+        return None
+    _, _, prefix, unit = row
+    zero = -info.zero if info.unit & 0x80 else info.zero
+    if info.range is None:
+        return (prefix, zero * prefix, unit)
+    return (info.range / 254.0 * prefix, zero * prefix, unit)
+
 def createAPDUHeader(apdu, klass, operationSpecifier, length):
     apdu.append(klass)
     apdu.append((operationSpecifier << 6) | (length & 0x3F))
 
-def createAPDU(klass, op, datapoints):
-    di = db.dataitemsByClass("magna", klass)
+def createAPDU(klass, op, datapoints, model = DEFAULT_MODEL):
+    di = db.dataitemsByClass(model, klass)
     result = []
     createAPDUHeader(result, klass, op, len(datapoints) * 2)
     for dp, value in datapoints:
@@ -80,8 +202,8 @@ def createAPDU(klass, op, datapoints):
         result.append(value)
     return result
 
-def createAPDUNoData(klass, op, datapoints):
-    di = db.dataitemsByClass("magna", klass)
+def createAPDUNoData(klass, op, datapoints, model = DEFAULT_MODEL):
+    di = db.dataitemsByClass(model, klass)
     result = []
     createAPDUHeader(result, klass, op, len(datapoints))
     for dp in datapoints:
@@ -89,40 +211,40 @@ def createAPDUNoData(klass, op, datapoints):
         result.append(item.id)
     return result
 
-def createGetInfoAPDU(klass, datapoints):
-    result = createAPDUNoData(klass, defs.Operation.INFO, datapoints)
+def createGetInfoAPDU(klass, datapoints, model = DEFAULT_MODEL):
+    result = createAPDUNoData(klass, defs.Operation.INFO, datapoints, model)
     return result
 
-def createGetMeasuredDataAPDU(klass, datapoints):
-    result = createAPDUNoData(klass, defs.Operation.GET, datapoints)
+def createGetMeasuredDataAPDU(klass, datapoints, model = DEFAULT_MODEL):
+    result = createAPDUNoData(klass, defs.Operation.GET, datapoints, model)
     return result
 
-def createSetCommandsAPDU(datapoints):
-    result = createAPDUNoData(defs.APDUClass.COMMANDS, defs.Operation.SET, datapoints)
+def createSetCommandsAPDU(datapoints, model = DEFAULT_MODEL):
+    result = createAPDUNoData(defs.APDUClass.COMMANDS, defs.Operation.SET, datapoints, model)
     return result
 
-def createGetReferencesAPDU(datapoints):
-    result = createAPDUNoData(defs.APDUClass.REFERENCE_VALUES, defs.Operation.GET, datapoints)
+def createGetReferencesAPDU(datapoints, model = DEFAULT_MODEL):
+    result = createAPDUNoData(defs.APDUClass.REFERENCE_VALUES, defs.Operation.GET, datapoints, model)
     return result
 
-def createSetReferencesAPDU(datapoints):
-    result = createAPDU(defs.APDUClass.REFERENCE_VALUES, defs.Operation.SET, datapoints)
+def createSetReferencesAPDU(datapoints, model = DEFAULT_MODEL):
+    result = createAPDU(defs.APDUClass.REFERENCE_VALUES, defs.Operation.SET, datapoints, model)
     return result
 
-def createGetStringsAPDU(datapoints):
-    result = createAPDUNoData(defs.APDUClass.ASCII_STRINGS, defs.Operation.GET, datapoints)
+def createGetStringsAPDU(datapoints, model = DEFAULT_MODEL):
+    result = createAPDUNoData(defs.APDUClass.ASCII_STRINGS, defs.Operation.GET, datapoints, model)
     return result
 
-def createGetParametersAPDU(datapoints):
-    result = createAPDUNoData(defs.APDUClass.CONFIGURATION_PARAMETERS, defs.Operation.GET, datapoints)
+def createGetParametersAPDU(datapoints, model = DEFAULT_MODEL):
+    result = createAPDUNoData(defs.APDUClass.CONFIGURATION_PARAMETERS, defs.Operation.GET, datapoints, model)
     return result
 
-def createSetParametersAPDU(datapoints):
-    result = createAPDU(defs.APDUClass.CONFIGURATION_PARAMETERS, defs.Operation.SET, datapoints)
+def createSetParametersAPDU(datapoints, model = DEFAULT_MODEL):
+    result = createAPDU(defs.APDUClass.CONFIGURATION_PARAMETERS, defs.Operation.SET, datapoints, model)
     return result
 
-def createGetProtocolDataAPDU(datapoints):
-    result = createAPDUNoData(defs.APDUClass.PROTOCOL_DATA, defs.Operation.GET, datapoints)
+def createGetProtocolDataAPDU(datapoints, model = DEFAULT_MODEL):
+    result = createAPDUNoData(defs.APDUClass.PROTOCOL_DATA, defs.Operation.GET, datapoints, model)
     return result
 
 class Header(object):
@@ -131,7 +253,7 @@ class Header(object):
         self.destAddr = destAddr
         self.sourceAddr = sourceAddr
 
-def createGetValuesPDU(klass, header, protocolData = [], measurements = [], parameter = [], references = [], strings = []):
+def createGetValuesPDU(klass, header, protocolData = [], measurements = [], parameter = [], references = [], strings = [], model = DEFAULT_MODEL):
     if not isinstance(header, Header):
         raise TypeError('Parameter "header" must be of type "Header".')
 
@@ -139,23 +261,23 @@ def createGetValuesPDU(klass, header, protocolData = [], measurements = [], para
     pdu = bytearray()
 
     if protocolData:
-        protocolAPDU = createGetProtocolDataAPDU(protocolData)
+        protocolAPDU = createGetProtocolDataAPDU(protocolData, model)
         length += len(protocolAPDU)
 
     if measurements:
-        measurementAPDU = createGetMeasuredDataAPDU(klass, measurements)
+        measurementAPDU = createGetMeasuredDataAPDU(klass, measurements, model)
         length += len(measurementAPDU)
 
     if parameter:
-        parameterAPDU = createGetParametersAPDU(parameter)
+        parameterAPDU = createGetParametersAPDU(parameter, model)
         length += len(parameterAPDU)
 
     if references:
-        referencesAPDU = createGetReferencesAPDU(references)
+        referencesAPDU = createGetReferencesAPDU(references, model)
         length += len(referencesAPDU)
 
     if strings:
-        stringsAPDU = createGetStringsAPDU(strings)
+        stringsAPDU = createGetStringsAPDU(strings, model)
         length += len(stringsAPDU )
 
     pdu.extend([header.startDelimiter, length, header.destAddr, header.sourceAddr])
@@ -179,7 +301,7 @@ def createGetValuesPDU(klass, header, protocolData = [], measurements = [], para
 
     return pdu
 
-def createSetValuesPDU(header, parameter = [], references = []):
+def createSetValuesPDU(header, parameter = [], references = [], model = DEFAULT_MODEL):
     if not isinstance(header, Header):
         raise TypeError('Parameter "header" must be of type "Header".')
 
@@ -187,11 +309,11 @@ def createSetValuesPDU(header, parameter = [], references = []):
     pdu = bytearray()
 
     if parameter:
-        parameterAPDU = createSetParametersAPDU(parameter)
+        parameterAPDU = createSetParametersAPDU(parameter, model)
         length += len(parameterAPDU)
 
     if references:
-        referencesAPDU = createSetReferencesAPDU(references)
+        referencesAPDU = createSetReferencesAPDU(references, model)
         length += len(referencesAPDU)
 
     pdu.extend([header.startDelimiter, length, header.destAddr, header.sourceAddr])
@@ -206,7 +328,7 @@ def createSetValuesPDU(header, parameter = [], references = []):
 
     return pdu
 
-def createGetInfoPDU(klass, header, measurements = [], parameter = [], references = []):
+def createGetInfoPDU(klass, header, measurements = [], parameter = [], references = [], model = DEFAULT_MODEL):
     ## To be defensive, at most 15 datapoints should be requested at once (min.frame length = 70 bytes).
     if not isinstance(header, Header):
         raise TypeError('Parameter "header" must be of type "Header".')
@@ -215,17 +337,17 @@ def createGetInfoPDU(klass, header, measurements = [], parameter = [], reference
     pdu = bytearray()
     if measurements:
         if klass == defs.APDUClass.MEASURED_DATA:
-            measurementsAPDU = createGetInfoAPDU(defs.APDUClass.MEASURED_DATA, measurements)
+            measurementsAPDU = createGetInfoAPDU(defs.APDUClass.MEASURED_DATA, measurements, model)
         if klass == defs.APDUClass.SIXTEENBIT_MEASURED_DATA:
-            measurementsAPDU = createGetInfoAPDU(defs.APDUClass.SIXTEENBIT_MEASURED_DATA, measurements)
+            measurementsAPDU = createGetInfoAPDU(defs.APDUClass.SIXTEENBIT_MEASURED_DATA, measurements, model)
         length += len(measurementsAPDU)
 
     if parameter:
-        parameterAPDU = createGetInfoAPDU(defs.APDUClass.CONFIGURATION_PARAMETERS, parameter)
+        parameterAPDU = createGetInfoAPDU(defs.APDUClass.CONFIGURATION_PARAMETERS, parameter, model)
         length += len(parameterAPDU)
 
     if references:
-        referencesAPDU = createGetInfoAPDU(defs.APDUClass.REFERENCE_VALUES, references)
+        referencesAPDU = createGetInfoAPDU(defs.APDUClass.REFERENCE_VALUES, references, model)
         length += len(referencesAPDU)
 
     pdu.extend([header.startDelimiter, length, header.destAddr, header.sourceAddr])
@@ -243,6 +365,213 @@ def createGetInfoPDU(klass, header, measurements = [], parameter = [], reference
 
     return pdu
 
+def createCompoundPDU(header, apdus):
+    """Assemble a telegram from several already built APDUs, e.g. a SET followed by the GET reading it back."""
+    if not isinstance(header, Header):
+        raise TypeError('Parameter "header" must be of type "Header".')
+
+    payload = bytearray()
+    for apdu in apdus:
+        payload.extend(apdu)
+
+    pdu = bytearray([header.startDelimiter, len(payload) + 2, header.destAddr, header.sourceAddr])
+    pdu.extend(payload)
+
+    pdu = crc.append_tel(pdu)
+
+    return pdu
+
+DEFAULT_BUF_LEN     = 70    # Smallest buffer a GENIBus unit is guaranteed to accept.
+MAX_APDU_DATA_LEN   = 0x3F  # Six bit APDU length field.
+
+def compositeLayout(name, model = DEFAULT_MODEL):
+    """Layout of `name` if it is a composite value on `model` (and not a plain datapoint there), else None."""
+    composite = COMPOSITES.get(name)
+    if composite is None or db.dataitemByClassAndName(model, name):
+        return None
+    items = [db.dataitemByClassAndName(model, part) for part in composite.parts]
+    if not all(items) or len(set(item.klass for item in items)) != 1:
+        return None
+    width = 16 if items[0].klass in SIXTEENBIT_CLASSES else 8
+    return Layout(composite.parts, width, composite.monotonic)
+
+def isKnown(name, model = DEFAULT_MODEL):
+    """Whether `model` has `name`, as a plain datapoint or a composite of its parts."""
+    return bool(db.dataitemByClassAndName(model, name) or compositeLayout(name, model))
+
+def createGetAPDUs(datapoints, maxData, model = DEFAULT_MODEL):
+    """GET APDUs for `datapoints`, grouped by class, each with at most `maxData` IDs.
+
+    16-bit classes get half as many IDs, so their replies stay within `maxData` bytes as well.
+
+    Composite values are expanded into their parts, which never end up in
+    different APDUs.
+    """
+    byClass = {}
+    for name in datapoints:
+        layout = compositeLayout(name, model)
+        items = [db.dataitemByClassAndName(model, part) for part in (layout.parts if layout else (name, ))]
+        if not all(items):
+            raise KeyError(name)
+        byClass.setdefault(items[0].klass, []).append([item.id for item in items])
+
+    apdus = []
+    for klass in sorted(byClass):
+        chunk = 1 if klass == defs.APDUClass.ASCII_STRINGS else min(MAX_APDU_DATA_LEN, maxData)
+        if klass in SIXTEENBIT_CLASSES:
+            # The reply carries two bytes per ID; keep it within the six bit length, too.
+            chunk //= 2
+        chunks = [[]]
+        for ids in byClass[klass]:
+            if chunks[-1] and len(chunks[-1]) + len(ids) > chunk:
+                chunks.append([])
+            chunks[-1].extend(ids)
+        for part in chunks:
+            apdu = []
+            createAPDUHeader(apdu, klass, defs.Operation.GET, len(part))
+            apdu.extend(part)
+            apdus.append((klass, apdu))
+    return apdus
+
+def replyLength(klass, op, data):
+    """Size of the reply to a request APDU with `data`: header plus what a GET returns.
+
+    Embedded PDUs are answered by the replies to the APDUs they tunnel.
+    """
+    if op != defs.Operation.GET:
+        return 2
+    if klass == defs.APDUClass.EMBEDDED_PUDS:
+        return 2 + sum(replyLength(*inner) for inner in iterAPDUs(data))
+    return 2 + len(data) * (2 if klass in SIXTEENBIT_CLASSES else 1)
+
+def packAPDUs(apdus, room):
+    """Greedily pack (class, apdu) pairs into groups of at most `room` bytes.
+
+    A group has to fit both ways, so each APDU counts with the larger of its
+    request and reply. APDUs asking for ASCII strings always form a group of
+    their own, as the length of the string in the reply is not known in advance.
+    """
+    groups = []
+    current = []
+    used = 0
+    for klass, apdu in apdus:
+        alone = klass == defs.APDUClass.ASCII_STRINGS
+        size = max(len(apdu), replyLength(klass, apdu[1] >> 6, apdu[2:]))
+        if current and (alone or used + size > room):
+            groups.append(current)
+            current, used = [], 0
+        current.append(apdu)
+        used += size
+        if alone:
+            groups.append(current)
+            current, used = [], 0
+    if current:
+        groups.append(current)
+    return groups
+
+def createGetPDUs(header, datapoints, bufLen = DEFAULT_BUF_LEN, model = DEFAULT_MODEL):
+    """Pack GET requests for arbitrary datapoints into as few telegrams as `bufLen` allows.
+
+    Returns a list of complete telegrams.
+    """
+    if not isinstance(header, Header):
+        raise TypeError('Parameter "header" must be of type "Header".')
+
+    # Header (4) + CRC (2) are part of the buffer, too.
+    room = max(bufLen, DEFAULT_BUF_LEN) - 6
+    apdus = createGetAPDUs(datapoints, room - 2, model)
+    return [createCompoundPDU(header, group) for group in packAPDUs(apdus, room)]
+
+SETTABLE_CLASSES = (
+    defs.APDUClass.CONFIGURATION_PARAMETERS,
+    defs.APDUClass.REFERENCE_VALUES,
+)
+
+def createSetAPDUs(values, maxData, model = DEFAULT_MODEL):
+    """SET APDUs writing `values` (name -> 8-bit value), grouped by class, each with at most `maxData` bytes."""
+    byClass = {}
+    for name, value in values.items():
+        item = db.dataitemByClassAndName(model, name)
+        if not item:
+            raise KeyError(name)
+        if item.klass not in SETTABLE_CLASSES or item.access == defs.Access.RO:
+            raise ValueError("Datapoint '{0}' is not writable".format(name))
+        if not 0 <= value <= 0xff:
+            raise ValueError("Value {0} out of range for '{1}'".format(value, name))
+        byClass.setdefault(item.klass, []).append((item.id, value))
+
+    apdus = []
+    chunk = min(MAX_APDU_DATA_LEN, maxData) // 2
+    for klass in sorted(byClass):
+        items = byClass[klass]
+        for start in range(0, len(items), chunk):
+            part = items[start : start + chunk]
+            apdu = []
+            createAPDUHeader(apdu, klass, defs.Operation.SET, len(part) * 2)
+            for ident, value in part:
+                apdu.extend((ident, value))
+            apdus.append((klass, apdu))
+    return apdus
+
+def createSetPDUs(header, values, bufLen = DEFAULT_BUF_LEN, model = DEFAULT_MODEL):
+    """Pack multi-item SETs for `values` into as few telegrams as `bufLen` allows."""
+    if not isinstance(header, Header):
+        raise TypeError('Parameter "header" must be of type "Header".')
+
+    room = max(bufLen, DEFAULT_BUF_LEN) - 6
+    apdus = createSetAPDUs(values, room - 2, model)
+    return [createCompoundPDU(header, group) for group in packAPDUs(apdus, room)]
+
+# An INFO reply carries up to four bytes per ID: head, unit, zero, range.
+INFO_REPLY_LEN = 4
+
+def createInfoPDUs(header, datapoints, bufLen = DEFAULT_BUF_LEN, model = DEFAULT_MODEL):
+    """INFO requests for the scaling of `datapoints`, one APDU per telegram, sized by the reply.
+
+    Datapoints of classes without INFO are left out.
+    """
+    if not isinstance(header, Header):
+        raise TypeError('Parameter "header" must be of type "Header".')
+
+    room = max(bufLen, DEFAULT_BUF_LEN) - 6
+    chunk = min(MAX_APDU_DATA_LEN, room - 2) // INFO_REPLY_LEN
+    byClass = {}
+    for name in datapoints:
+        item = db.dataitemByClassAndName(model, name)
+        if item and defs.Operation.INFO in defs.CLASS_CAPABILITIES.get(item.klass, ()):
+            byClass.setdefault(item.klass, []).append(name)
+    pdus = []
+    for klass in sorted(byClass):
+        names = byClass[klass]
+        for start in range(0, len(names), chunk):
+            pdus.append(createCompoundPDU(header, [createGetInfoAPDU(klass, names[start : start + chunk], model)]))
+    return pdus
+
+def createEmbeddedPDUs(header, datapoints, bufLen = DEFAULT_BUF_LEN, model = DEFAULT_MODEL):
+    """Tunnel GET requests for a unit behind `header.destAddr` through class 9 (embedded PDU) APDUs.
+
+    Inner APDUs are packed into as few class 9 APDUs as the six bit length
+    field allows, and those into as few telegrams as `bufLen` allows; the
+    replies are demultiplexed by decodeEmbeddedReply(). `model` is the
+    catalog model of the inner unit.
+    """
+    if not isinstance(header, Header):
+        raise TypeError('Parameter "header" must be of type "Header".')
+
+    room = max(bufLen, DEFAULT_BUF_LEN) - 6
+    outerRoom = min(MAX_APDU_DATA_LEN, room - 2)
+    inner = createGetAPDUs(datapoints, outerRoom - 2, model)
+    outer = []
+    for group in packAPDUs(inner, outerRoom):
+        payload = [byte for apdu in group for byte in apdu]
+        apdu = []
+        createAPDUHeader(apdu, defs.APDUClass.EMBEDDED_PUDS, defs.Operation.GET, len(payload))
+        apdu.extend(payload)
+        # A tunnelled string request still has to travel alone.
+        klass = defs.APDUClass.ASCII_STRINGS if group[0][0] == defs.APDUClass.ASCII_STRINGS else defs.APDUClass.EMBEDDED_PUDS
+        outer.append((klass, apdu))
+    return [createCompoundPDU(header, group) for group in packAPDUs(outer, room)]
+
 def createSetCommandsPDU(header, commands):
     if not isinstance(header, Header):
         raise TypeError('Parameter "header" must be of type "Header".')
@@ -0,0 +1,88 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+##
+## Precompiled reply decoder for request plans.
+##
+## decodeReply() walks a reply byte by byte and resolves every ID through the
+## device database. The telegrams of a poll plan never change, though, so the
+## layout of a positive reply is known up front: ReplyCodec compiles it once
+## into a struct.Struct for the values and another one for the APDU headers,
+## and decoding a reply becomes two unpack_from() calls and a zip(). Replies
+## that don't match the expected layout (NAKs, short data, strings, class 9)
+## take the generic decodeReply() path, so results are always the same.
+##
+
+import struct
+
+from . import gbdefs as defs
+from .apdu import db, decodeReply, DEFAULT_MODEL, SIXTEENBIT_CLASSES, splitAPDUs
+
+
+class ReplyCodec(object):
+
+    def __init__(self, request, model = DEFAULT_MODEL):
+        self.request = bytes(request)
+        self.model = model
+        self._values = None
+        self._compile()
+
+    def _compile(self):
+        valueFormat = ['>', '{0}x'.format(defs.PDU_START)]
+        headerFormat = ['>', '{0}x'.format(defs.PDU_START)]
+        headers = []
+        names = []
+        length = defs.PDU_START
+        for klass, op, ids in splitAPDUs(self.request):
+            if op != defs.Operation.GET or klass in (defs.APDUClass.ASCII_STRINGS, defs.APDUClass.EMBEDDED_PUDS):
+                return
+            width = 2 if klass in SIXTEENBIT_CLASSES else 1
+            dataLength = len(ids) * width
+            byName = {item.id: name for name, item in (db.dataitemsByClass(self.model, klass) or {}).items()}
+            valueFormat.append('2x{0}{1}'.format(len(ids), 'H' if width == 2 else 'B'))
+            headerFormat.append('BB{0}x'.format(dataLength))
+            headers.extend((klass, (defs.Acknowledge.OK << 6) | dataLength))
+            names.extend(byName.get(ident, ident) for ident in ids)
+            length += 2 + dataLength
+        self._values = struct.Struct(''.join(valueFormat))
+        self._headers = struct.Struct(''.join(headerFormat))
+        self._expectedHeaders = tuple(headers)
+        self._names = tuple(names)
+        self._length = length + 2   # CRC.
+
+    @property
+    def compiled(self):
+        return self._values is not None
+
+    def decode(self, reply):
+        """Datapoint name -> value of a reply (CRC already verified) to the compiled request."""
+        if self._values is not None and len(reply) == self._length:
+            view = memoryview(reply)
+            if self._headers.unpack_from(view) == self._expectedHeaders:
+                return dict(zip(self._names, self._values.unpack_from(view)))
+        return decodeReply(self.request, reply, self.model)
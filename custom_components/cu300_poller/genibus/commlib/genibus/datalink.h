@@ -31,6 +31,7 @@ extern "C"
 {
 #endif  /* __cplusplus */
 
+#include "genibus/gb_config.h"
 #include "genibus/types.h"
 #include "genibus/crc.h"
 #include "genibus/interface.h"
@@ -57,22 +58,29 @@ typedef enum tagDl_Error {
 } Dl_Error;
 
 typedef enum tagGb_Error {
-    ERR_INVALID_CRC
+    ERR_INVALID_CRC,
+    ERR_FRAME_TOO_LONG
 } Gb_Error;
 
 typedef void (*Dl_Callout)(uint8 * buffer, uint8 len);
 typedef void (*Error_Callout)(Gb_Error error, uint8 * buffer, uint8 len);
 
+/*
+** The fields touched for every received byte come first and share a cache line
+** with the pointers; the frame buffer, of which only the current byte is
+** written, goes last.
+*/
 typedef struct tagDatalinkLayerType {
     Interface * port;
     Dl_Callout dataLinkCallout;
     Error_Callout errorCallout;
-    uint8 scratchBuffer[0xff];
     //Crc _crc;
     Dl_State state;
     uint8 frameLength;
     boolean checked;
     uint8 frameIdx;
+    uint8 byteCount;
+    uint8 scratchBuffer[GB_CFG_FRAME_SIZE];
 } DatalinkLayerType;
 
 void LinkLayer_Init(DatalinkLayerType * linkLayer);
@@ -80,8 +88,10 @@ void LinkLayer_Reset(DatalinkLayerType * linkLayer);
 void LinkLayer_SetState(DatalinkLayerType * linkLayer, Dl_State state);
 Dl_State LinkLayer_GetState(DatalinkLayerType * linkLayer);
 void LinkLayer_Feed(DatalinkLayerType * linkLayer);
+uint16 LinkLayer_Process(DatalinkLayerType * linkLayer, uint16 budget);
 boolean LinkLayer_VerifyCRC(DatalinkLayerType * linkLayer);
 void LinkLayer_SendPDU(DatalinkLayerType * linkLayer, uint8 sd, uint8 da, uint8 sa, uint8 const * data, uint8 len);
+uint8 LinkLayer_BuildFrame(uint8 * frame, uint8 sd, uint8 da, uint8 sa, uint8 const * data, uint8 len);
 void LinkLayer_ConnectRequest(DatalinkLayerType * linkLayer, uint8 sa);
 
 #if 0
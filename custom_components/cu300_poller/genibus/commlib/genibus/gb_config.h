@@ -0,0 +1,125 @@
+/*
+ *  Grundfos GENIBus Library.
+ *
+ *  (C) 2007-2016 by Christoph Schueler <github.com/Christoph2,
+ *                                       cpu12.gems@googlemail.com>
+ *
+ *   All Rights Reserved
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+
+#if !defined(__GB_CONFIG_H)
+#define __GB_CONFIG_H
+
+/*
+** Compile-time sizing of the library.
+**
+** Every buffer of the static profile (frame pool, transmit queue, slave table)
+** is dimensioned from the values below; nothing is allocated at run-time.
+** Override any of them on the compiler command line or in a project header
+** named by GB_CFG_USER_CONFIG, e.g. -DGB_CFG_USER_CONFIG=\"gateway_config.h\".
+*/
+
+#if defined(GB_CFG_USER_CONFIG)
+#include GB_CFG_USER_CONFIG
+#endif
+
+/*
+** Build profile: 0 = hosted (POSIX serial port, timer signal, stdio debug output),
+** 1 = static (no heap, no stdio, no signals; cooperative Gb_Poll() API).
+*/
+#if !defined(GB_CFG_STATIC)
+    #define GB_CFG_STATIC               (0)
+#endif
+
+/* Largest telegram incl. SD, LEN, DA, SA and CRC; the LEN byte limits this to 0xff. */
+#if !defined(GB_CFG_FRAME_SIZE)
+    #define GB_CFG_FRAME_SIZE           (0xff)
+#endif
+
+/* Telegrams that can be queued for transmission at the same time. */
+#if !defined(GB_CFG_FRAME_POOL_SIZE)
+    #define GB_CFG_FRAME_POOL_SIZE      (4)
+#endif
+
+/* Depth of the transmit queue; more than the pool would never be used. */
+#if !defined(GB_CFG_TX_QUEUE_LEN)
+    #define GB_CFG_TX_QUEUE_LEN         GB_CFG_FRAME_POOL_SIZE
+#endif
+
+/* Entries of the slave table. */
+#if !defined(GB_CFG_MAX_SLAVES)
+    #define GB_CFG_MAX_SLAVES           (8)
+#endif
+
+/* Upper bound of received bytes processed per Gb_Poll() call (worst-case run-time). */
+#if !defined(GB_CFG_RX_BYTES_PER_POLL)
+    #define GB_CFG_RX_BYTES_PER_POLL    (16)
+#endif
+
+/* Reply timeout, in the ticks passed to Gb_Poll(). */
+#if !defined(GB_CFG_REPLY_TIMEOUT)
+    #define GB_CFG_REPLY_TIMEOUT        (60)
+#endif
+
+/* RAM the static profile may use; checked at compile-time. */
+#if !defined(GB_CFG_RAM_BUDGET)
+    #define GB_CFG_RAM_BUDGET           (2048)
+#endif
+
+/* Entries of the slave registry (gb_registry.h); a gateway scanning many buses needs far more than an MCU. */
+#if !defined(GB_CFG_REGISTRY_SIZE)
+    #if GB_CFG_STATIC == 1
+        #define GB_CFG_REGISTRY_SIZE    GB_CFG_MAX_SLAVES
+    #else
+        #define GB_CFG_REGISTRY_SIZE    (1024)
+    #endif
+#endif
+
+/* Consecutive timeouts after which a slave is quarantined ... */
+#if !defined(GB_CFG_QUARANTINE_AFTER)
+    #define GB_CFG_QUARANTINE_AFTER     (3)
+#endif
+
+/* ... and the cap of its exponential back-off, as a power of two of its poll interval. */
+#if !defined(GB_CFG_QUARANTINE_MAX_SHIFT)
+    #define GB_CFG_QUARANTINE_MAX_SHIFT (6)
+#endif
+
+#if (GB_CFG_FRAME_SIZE < 8) || (GB_CFG_FRAME_SIZE > 0xff)
+    #error "GB_CFG_FRAME_SIZE must be in the range 8..255"
+#endif
+
+#if (GB_CFG_FRAME_POOL_SIZE < 1) || (GB_CFG_FRAME_POOL_SIZE > 0xff)
+    #error "GB_CFG_FRAME_POOL_SIZE must be in the range 1..255"
+#endif
+
+#if (GB_CFG_TX_QUEUE_LEN > GB_CFG_FRAME_POOL_SIZE)
+    #error "GB_CFG_TX_QUEUE_LEN must not exceed GB_CFG_FRAME_POOL_SIZE"
+#endif
+
+#if (GB_CFG_MAX_SLAVES < 1) || (GB_CFG_MAX_SLAVES > 0xff)
+    #error "GB_CFG_MAX_SLAVES must be in the range 1..255"
+#endif
+
+#if (GB_CFG_REGISTRY_SIZE < 1) || (GB_CFG_REGISTRY_SIZE > 0x7fff)
+    #error "GB_CFG_REGISTRY_SIZE must be in the range 1..32767"
+#endif
+
+#endif /* __GB_CONFIG_H */
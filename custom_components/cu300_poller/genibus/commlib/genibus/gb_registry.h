@@ -0,0 +1,89 @@
+/*
+ *  Grundfos GENIBus Library.
+ *
+ *  (C) 2007-2016 by Christoph Schueler <github.com/Christoph2,
+ *                                       cpu12.gems@googlemail.com>
+ *
+ *   All Rights Reserved
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+
+#if !defined(__GB_REGISTRY_H)
+#define __GB_REGISTRY_H
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif  /* __cplusplus */
+
+/*
+** Slave registry: per-slave state of every unit the master talks to, on one
+** or more buses, stored as a struct of arrays. The fields the scheduler reads
+** on every pass (next-due time, RTT estimate, quarantine state) are separate,
+** densely packed arrays, so finding the due slaves touches one uint32 per
+** slave -- 16 slaves per 64-byte cache line -- while identity and counters
+** stay out of the way until a slave is actually polled.
+**
+** Times are in the ticks of the `now` arguments and compared modulo 2^32.
+*/
+
+#include "genibus/types.h"
+#include "genibus/gb_config.h"
+
+#define GB_REGISTRY_NONE        ((sint16)-1)
+
+typedef enum tagGb_SlaveStateType {
+    GB_SLAVE_ACTIVE,
+    GB_SLAVE_SUSPECT,       /* Missed replies, not yet quarantined. */
+    GB_SLAVE_QUARANTINED    /* Polled only after an exponential back-off. */
+} Gb_SlaveStateType;
+
+typedef struct tagGb_RegistryType {
+    /* Hot: scanned or updated on every scheduler pass. */
+    uint32 nextDue[GB_CFG_REGISTRY_SIZE];
+    uint16 srtt[GB_CFG_REGISTRY_SIZE];          /* Smoothed RTT, scaled by 8. */
+    uint16 rttVar[GB_CFG_REGISTRY_SIZE];        /* RTT mean deviation, scaled by 4. */
+    uint8 state[GB_CFG_REGISTRY_SIZE];
+    uint8 failures[GB_CFG_REGISTRY_SIZE];
+    /* Cold: identity, configuration and counters. */
+    uint8 bus[GB_CFG_REGISTRY_SIZE];
+    uint8 address[GB_CFG_REGISTRY_SIZE];
+    uint8 unitFamily[GB_CFG_REGISTRY_SIZE];
+    uint8 unitType[GB_CFG_REGISTRY_SIZE];
+    uint16 interval[GB_CFG_REGISTRY_SIZE];
+    uint32 lastSeen[GB_CFG_REGISTRY_SIZE];
+    uint16 replies[GB_CFG_REGISTRY_SIZE];
+    uint16 timeouts[GB_CFG_REGISTRY_SIZE];
+    uint16 count;
+} Gb_RegistryType;
+
+void Gb_Registry_Init(Gb_RegistryType * registry);
+sint16 Gb_Registry_Add(Gb_RegistryType * registry, uint8 bus, uint8 address, uint16 interval, uint32 now);
+sint16 Gb_Registry_Find(Gb_RegistryType const * registry, uint8 bus, uint8 address);
+uint16 Gb_Registry_Due(Gb_RegistryType const * registry, uint32 now, uint16 * handles, uint16 maxHandles);
+void Gb_Registry_Reply(Gb_RegistryType * registry, uint16 handle, uint32 now, uint16 rtt);
+void Gb_Registry_Timeout(Gb_RegistryType * registry, uint16 handle, uint32 now);
+uint16 Gb_Registry_ReplyTimeout(Gb_RegistryType const * registry, uint16 handle);
+void Gb_Registry_SetIdentity(Gb_RegistryType * registry, uint16 handle, uint8 unitFamily, uint8 unitType);
+
+#if defined(__cplusplus)
+}
+#endif  /* __cplusplus */
+
+#endif /* __GB_REGISTRY_H */
@@ -0,0 +1,88 @@
+/*
+ *  Grundfos GENIBus Library.
+ *
+ *  (C) 2007-2016 by Christoph Schueler <github.com/Christoph2,
+ *                                       cpu12.gems@googlemail.com>
+ *
+ *   All Rights Reserved
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+
+#if !defined(__GB_STATIC_H)
+#define __GB_STATIC_H
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif  /* __cplusplus */
+
+/*
+** Static build profile: one bus master with all storage reserved at compile-time
+** (see gb_config.h) and a cooperative API. The application calls Gb_Poll() from
+** its main loop or a periodic task; no call blocks, and each call touches at most
+** GB_CFG_RX_BYTES_PER_POLL received bytes.
+*/
+
+#include "genibus/datalink.h"
+
+typedef enum tagGb_StatusType {
+    GB_OK,
+    GB_E_FULL,          /* No free frame, queue entry or slave table entry. */
+    GB_E_LENGTH,        /* APDUs don't fit into GB_CFG_FRAME_SIZE. */
+    GB_E_UNKNOWN_SLAVE
+} Gb_StatusType;
+
+typedef enum tagGb_ResultType {
+    GB_RESULT_REPLY,
+    GB_RESULT_TIMEOUT,
+    GB_RESULT_CRC
+} Gb_ResultType;
+
+/* Outcome of a request; `frame` is only valid during the call. */
+typedef void (*Gb_ReplyCallout)(uint8 slave, Gb_ResultType result, uint8 const * frame, uint8 len);
+
+typedef struct tagGb_SlaveType {
+    uint8 address;
+    uint8 pending;
+    uint16 replies;
+    uint16 timeouts;
+    uint16 crcErrors;
+} Gb_SlaveType;
+
+typedef struct tagGb_FrameType {
+    uint8 length;
+    uint8 slave;        /* Index into the slave table. */
+    uint8 data[GB_CFG_FRAME_SIZE];
+} Gb_FrameType;
+
+void Gb_Init(Interface * port, uint8 sourceAddress, Gb_ReplyCallout callout);
+Gb_StatusType Gb_AddSlave(uint8 address);
+Gb_SlaveType const * Gb_GetSlave(uint8 address);
+Gb_StatusType Gb_Submit(uint8 address, uint8 const * apdus, uint8 len);
+void Gb_Poll(uint32 now);
+boolean Gb_Idle(void);
+
+/* Total RAM reserved by the static profile (including one slave registry), for link-map cross-checks. */
+extern const SizeType Gb_StaticFootprint;
+
+#if defined(__cplusplus)
+}
+#endif  /* __cplusplus */
+
+#endif /* __GB_STATIC_H */
@@ -0,0 +1,89 @@
+/*
+ *  Grundfos GENIBus Library.
+ *
+ *  (C) 2007-2016 by Christoph Schueler <github.com/Christoph2,
+ *                                       cpu12.gems@googlemail.com>
+ *
+ *   All Rights Reserved
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+
+#if !defined(__POSIX_RT_H)
+#define __POSIX_RT_H
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif  /* __cplusplus */
+
+/*
+** Optional real-time mode of the hosted (POSIX) build: pins the bus thread to
+** a CPU, runs it under SCHED_FIFO, locks all memory and prefaults the stack,
+** and transmits at absolute deadlines while recording how late each frame
+** actually left (jitter histogram).
+*/
+
+#include <stdint.h>
+#include <time.h>
+
+#include "genibus/types.h"
+#include "genibus/interface.h"
+
+/* Histogram buckets: [0, 1us), [1, 2us), [2, 4us) ... the last one is open-ended. */
+#if !defined(GB_RT_JITTER_BUCKETS)
+    #define GB_RT_JITTER_BUCKETS    (20)
+#endif
+
+/* Stack prefaulted by Port_Rt_Init(), so the bus thread never page-faults on it. */
+#if !defined(GB_RT_STACK_PREFAULT)
+    #define GB_RT_STACK_PREFAULT    (64 * 1024)
+#endif
+
+typedef struct tagPort_Rt_ConfigType {
+    sint16 cpu;             /* CPU to pin the calling thread to, -1 = don't pin. */
+    sint16 priority;        /* SCHED_FIFO priority (1..99), 0 = keep the scheduling policy. */
+    boolean lockMemory;     /* mlockall(MCL_CURRENT | MCL_FUTURE). */
+} Port_Rt_ConfigType;
+
+/* Port_Rt_Init() result: one bit per step that failed (usually missing privileges). */
+#define PORT_RT_ERR_AFFINITY    ((uint8)0x01)
+#define PORT_RT_ERR_SCHEDULER   ((uint8)0x02)
+#define PORT_RT_ERR_MLOCK       ((uint8)0x04)
+
+typedef struct tagPort_Rt_JitterType {
+    uint32 buckets[GB_RT_JITTER_BUCKETS];
+    uint32 count;
+    uint32 minUs;
+    uint32 maxUs;
+    uint64_t sumUs;         /* Lateness adds up over long runs; 32 bits would wrap. */
+} Port_Rt_JitterType;
+
+uint8 Port_Rt_Init(Port_Rt_ConfigType const * config);
+void Port_Rt_Deadline(struct timespec * deadline, uint32 offsetUs);
+boolean Port_Rt_TransmitAt(struct timespec const * deadline, Interface const * port, uint8 const * buffer, uint16 len);
+void Port_Rt_RecordJitter(struct timespec const * scheduled, struct timespec const * actual);
+void Port_Rt_GetJitter(Port_Rt_JitterType * jitter);
+void Port_Rt_ResetJitter(void);
+void Port_Rt_DumpJitter(void);
+
+#if defined(__cplusplus)
+}
+#endif  /* __cplusplus */
+
+#endif /* __POSIX_RT_H */
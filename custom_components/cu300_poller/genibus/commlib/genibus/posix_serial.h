@@ -26,6 +26,7 @@
 #define __PORT_SERIAL_H
 
 #include <stdint.h>
+#include <time.h>
 
 typedef uint8_t boolean;
 
@@ -61,6 +62,7 @@ typedef enum tagPollingResultType {
 
 boolean Port_Serial_Init(uint8_t portNumber);
 boolean Port_Serial_Write(uint8_t const * buffer, uint32_t byteCount);
+boolean Port_Serial_WriteAt(struct timespec const * deadline, uint8_t const * buffer, uint16_t byteCount);
 PollingResultType Port_Serial_Poll(boolean writing, uint16_t * events);
 uint16_t Port_Serial_BytesWaiting(uint32_t * errors);
 uint16_t Port_Serial_Read(uint8_t * buffer, uint16_t byteCount);
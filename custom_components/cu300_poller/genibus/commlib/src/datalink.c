@@ -24,7 +24,19 @@
 
 
 #include "genibus/datalink.h"
-#include <stdio.h>
+
+#if defined(GB_DATALINK_DEBUG) && (GB_CFG_STATIC == 0)
+    #include <stdio.h>
+    #define DL_DBG(...)     printf(__VA_ARGS__)
+#else
+    #define DL_DBG(...)     VOID_EXPRESSION()
+#endif
+
+/* SD, LEN, DA, SA in front of the data, CRC high and low byte after it. */
+#define DL_HEADER_SIZE      ((uint8)0x04)
+#define DL_OVERHEAD         ((uint8)0x06)
+
+static uint16 LinkLayer_CalculateCRC(uint8 const * frame, uint8 len);
 
 
 static const uint8 connectReqPayload[] = {
@@ -42,6 +54,7 @@ void LinkLayer_Reset(DatalinkLayerType * linkLayer)
     LinkLayer_SetState(linkLayer, DL_IDLE);
     linkLayer->frameLength = 0;
     linkLayer->frameIdx = 0;
+    linkLayer->byteCount = 0;
 }
 
 void LinkLayer_SetState(DatalinkLayerType * linkLayer, Dl_State state)
@@ -56,22 +69,36 @@ Dl_State LinkLayer_GetState(DatalinkLayerType * linkLayer)
 
 void LinkLayer_Feed(DatalinkLayerType * linkLayer)
 {
-    static uint8 byteCount;
+    (void)LinkLayer_Process(linkLayer, (uint16)0xffffU);
+}
+
+/*!
+ *  Deframe at most `budget` received bytes; returns the number of bytes consumed.
+ *  Processing stops after a complete frame, so callouts see one frame per call.
+ */
+uint16 LinkLayer_Process(DatalinkLayerType * linkLayer, uint16 budget)
+{
+    uint16 processed = (uint16)0;
     uint8 receivedByte;
 
-    while (linkLayer->port->available() > 0) {
+    while ((processed < budget) && (linkLayer->port->available() > 0)) {
         receivedByte = linkLayer->port->readByte();
+        ++processed;
         linkLayer->scratchBuffer[linkLayer->frameIdx] = receivedByte;
         if (linkLayer->frameIdx == 1) {
-            byteCount =  receivedByte + 3;
-            linkLayer->frameLength = byteCount + 1;
+            if (receivedByte > (GB_CFG_FRAME_SIZE - DL_HEADER_SIZE)) {
+                if (linkLayer->errorCallout != NULL) {
+                    linkLayer->errorCallout(ERR_FRAME_TOO_LONG, linkLayer->scratchBuffer, (uint8)2);
+                }
+                LinkLayer_Reset(linkLayer);
+                continue;
+            }
+            linkLayer->byteCount = receivedByte + 3;
+            linkLayer->frameLength = receivedByte + DL_HEADER_SIZE;
             LinkLayer_SetState(linkLayer, DL_RECEIVING);
-        } else if (linkLayer->frameIdx == 0) {
-           // printf("START.\n");
         }
         if (LinkLayer_GetState(linkLayer) == DL_RECEIVING) {
-            //printf("%u\n", byteCount);
-            if (--byteCount == 0) {
+            if (--linkLayer->byteCount == 0) {
                 if (LinkLayer_VerifyCRC(linkLayer)) {
                     if (linkLayer->dataLinkCallout != NULL) {
                         linkLayer->dataLinkCallout(linkLayer->scratchBuffer, linkLayer->frameLength);
@@ -88,6 +115,15 @@ void LinkLayer_Feed(DatalinkLayerType * linkLayer)
         }
         ++linkLayer->frameIdx;
     }
+    return processed;
+}
+
+/*!
+ *  GENIbus CRC: CCITT over LEN..last data byte, complemented.
+ */
+static uint16 LinkLayer_CalculateCRC(uint8 const * frame, uint8 len)
+{
+    return Crc_CalculateCRC16(frame + 1, len, 0xffff) ^ (uint16)0xffffU;
 }
 
 boolean LinkLayer_VerifyCRC(DatalinkLayerType * linkLayer)
@@ -96,36 +132,54 @@ boolean LinkLayer_VerifyCRC(DatalinkLayerType * linkLayer)
     uint16 receivedCrc;
 
     receivedCrc = MAKEWORD(linkLayer->scratchBuffer[linkLayer->frameLength - 2], linkLayer->scratchBuffer[linkLayer->frameLength - 1]);
-    calculatedCrc = Crc_CalculateCRC16(linkLayer->scratchBuffer + 1, linkLayer->frameLength - 2, 0xffff);
-    printf("R: %#4X C: %#4X\n", receivedCrc, calculatedCrc);
+    calculatedCrc = LinkLayer_CalculateCRC(linkLayer->scratchBuffer, linkLayer->frameLength - 3);
+    DL_DBG("R: %#4X C: %#4X\n", receivedCrc, calculatedCrc);
     return receivedCrc == calculatedCrc;
 }
 
-void LinkLayer_SendPDU(DatalinkLayerType * linkLayer, uint8 sd, uint8 da, uint8 sa, uint8 const * data, uint8 len)
+/*!
+ *  Assemble a complete telegram in `frame` (GB_CFG_FRAME_SIZE bytes);
+ *  returns its length, 0 if the data doesn't fit.
+ */
+uint8 LinkLayer_BuildFrame(uint8 * frame, uint8 sd, uint8 da, uint8 sa, uint8 const * data, uint8 len)
 {
     uint8 idx;
     uint16 calculatedCrc;
 
-    if (LinkLayer_GetState(linkLayer) != DL_IDLE) {
-        return;
+    if (len > (GB_CFG_FRAME_SIZE - DL_OVERHEAD)) {
+        return (uint8)0x00;
     }
 
-    LinkLayer_SetState(linkLayer, DL_SENDING);
-
-    linkLayer->scratchBuffer[0] = sd;
-    linkLayer->scratchBuffer[1] = len + ((uint8)0x02);
-    linkLayer->scratchBuffer[2] = da;
-    linkLayer->scratchBuffer[3] = sa;
+    frame[0] = sd;
+    frame[1] = len + ((uint8)0x02);
+    frame[2] = da;
+    frame[3] = sa;
 
     for (idx = ((uint8)0x00); idx < len; ++idx) {
-        linkLayer->scratchBuffer[idx + ((uint8)0x04)] = data[idx];
+        frame[idx + DL_HEADER_SIZE] = data[idx];
     }
 
-    calculatedCrc = Crc_CalculateCRC16(linkLayer->scratchBuffer + 1, len - 2, 0xffff);
-    linkLayer->scratchBuffer[idx] = HIBYTE(calculatedCrc);
-    linkLayer->scratchBuffer[idx + 1] = LOBYTE(calculatedCrc);
+    calculatedCrc = LinkLayer_CalculateCRC(frame, len + ((uint8)0x03));
+    frame[len + DL_HEADER_SIZE] = HIBYTE(calculatedCrc);
+    frame[len + DL_HEADER_SIZE + 1] = LOBYTE(calculatedCrc);
 
-    linkLayer->port->writeFrame(linkLayer->scratchBuffer, len);
+    return len + DL_OVERHEAD;
+}
+
+void LinkLayer_SendPDU(DatalinkLayerType * linkLayer, uint8 sd, uint8 da, uint8 sa, uint8 const * data, uint8 len)
+{
+    uint8 frameLength;
+
+    if (LinkLayer_GetState(linkLayer) != DL_IDLE) {
+        return;
+    }
+
+    LinkLayer_SetState(linkLayer, DL_SENDING);
+
+    frameLength = LinkLayer_BuildFrame(linkLayer->scratchBuffer, sd, da, sa, data, len);
+    if (frameLength != (uint8)0x00) {
+        linkLayer->port->writeFrame(linkLayer->scratchBuffer, frameLength);
+    }
 
     LinkLayer_SetState(linkLayer, DL_IDLE);
 }
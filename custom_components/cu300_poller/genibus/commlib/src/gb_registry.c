@@ -0,0 +1,177 @@
+/*
+ *  Grundfos GENIBus Library.
+ *
+ *  (C) 2007-2016 by Christoph Schueler <github.com/Christoph2,
+ *                                       cpu12.gems@googlemail.com>
+ *
+ *   All Rights Reserved
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+
+
+#include "genibus/gb_registry.h"
+
+/*
+** RTT estimation follows Jacobson/Karels (as TCP does): srtt += (rtt - srtt) / 8,
+** rttVar += (|rtt - srtt| - rttVar) / 4, reply timeout = srtt + 4 * rttVar,
+** everything in fixed point so no division or floating point is needed.
+*/
+
+/* uint32 is an unsigned long, 64 bits wide on LP64 hosts, so ticks are reduced modulo 2^32 explicitly. */
+#define GB_TICKS(t)                 ((uint32)(t) & (uint32)0xffffffffUL)
+#define GB_DUE(registry, idx, now)  (GB_TICKS((uint32)(now) - (registry)->nextDue[(idx)]) < (uint32)0x80000000UL)
+
+void Gb_Registry_Init(Gb_RegistryType * registry)
+{
+    registry->count = (uint16)0;
+}
+
+sint16 Gb_Registry_Add(Gb_RegistryType * registry, uint8 bus, uint8 address, uint16 interval, uint32 now)
+{
+    sint16 handle = Gb_Registry_Find(registry, bus, address);
+    uint16 idx;
+
+    if (handle != GB_REGISTRY_NONE) {
+        registry->interval[handle] = interval;
+        return handle;
+    }
+    if (registry->count >= GB_CFG_REGISTRY_SIZE) {
+        return GB_REGISTRY_NONE;
+    }
+    idx = registry->count++;
+    registry->nextDue[idx] = GB_TICKS(now);
+    registry->srtt[idx] = (uint16)0;
+    registry->rttVar[idx] = (uint16)0;
+    registry->state[idx] = (uint8)GB_SLAVE_ACTIVE;
+    registry->failures[idx] = (uint8)0;
+    registry->bus[idx] = bus;
+    registry->address[idx] = address;
+    registry->unitFamily[idx] = (uint8)0;
+    registry->unitType[idx] = (uint8)0;
+    registry->interval[idx] = interval;
+    registry->lastSeen[idx] = GB_TICKS(now);
+    registry->replies[idx] = (uint16)0;
+    registry->timeouts[idx] = (uint16)0;
+    return (sint16)idx;
+}
+
+sint16 Gb_Registry_Find(Gb_RegistryType const * registry, uint8 bus, uint8 address)
+{
+    uint16 idx;
+
+    for (idx = (uint16)0; idx < registry->count; ++idx) {
+        if ((registry->address[idx] == address) && (registry->bus[idx] == bus)) {
+            return (sint16)idx;
+        }
+    }
+    return GB_REGISTRY_NONE;
+}
+
+/*!
+ *  Collect up to `maxHandles` slaves that are due at `now`; returns how many were found.
+ *  Only the nextDue array is read, quarantined slaves are due once their back-off expired.
+ */
+uint16 Gb_Registry_Due(Gb_RegistryType const * registry, uint32 now, uint16 * handles, uint16 maxHandles)
+{
+    uint16 idx;
+    uint16 found = (uint16)0;
+
+    for (idx = (uint16)0; (idx < registry->count) && (found < maxHandles); ++idx) {
+        if (GB_DUE(registry, idx, now)) {
+            handles[found++] = idx;
+        }
+    }
+    return found;
+}
+
+void Gb_Registry_Reply(Gb_RegistryType * registry, uint16 handle, uint32 now, uint16 rtt)
+{
+    sint32 delta;
+    uint32 srtt;
+    uint32 rttVar;
+
+    if (registry->srtt[handle] == (uint16)0) {
+        srtt = (uint32)rtt << 3;
+        rttVar = (uint32)rtt << 1;
+    } else {
+        srtt = registry->srtt[handle];
+        rttVar = registry->rttVar[handle];
+        delta = (sint32)rtt - (sint32)(srtt >> 3);
+        srtt = (uint32)((sint32)srtt + delta);
+        if (delta < 0) {
+            delta = -delta;
+        }
+        rttVar = (uint32)((sint32)rttVar + delta - (sint32)(rttVar >> 2));
+    }
+    registry->srtt[handle] = (srtt > 0xffffu) ? (uint16)0xffffu : (uint16)srtt;
+    registry->rttVar[handle] = (rttVar > 0xffffu) ? (uint16)0xffffu : (uint16)rttVar;
+    registry->state[handle] = (uint8)GB_SLAVE_ACTIVE;
+    registry->failures[handle] = (uint8)0;
+    registry->nextDue[handle] = GB_TICKS(now + registry->interval[handle]);
+    registry->lastSeen[handle] = GB_TICKS(now);
+    ++registry->replies[handle];
+}
+
+/*!
+ *  A missed reply: the slave is retried after its normal interval until it missed
+ *  GB_CFG_QUARANTINE_AFTER replies in a row, then quarantined with an exponential
+ *  back-off, so dead units don't eat up the bus time of the live ones.
+ */
+void Gb_Registry_Timeout(Gb_RegistryType * registry, uint16 handle, uint32 now)
+{
+    uint8 failures = registry->failures[handle];
+    uint8 shift = (uint8)0;
+
+    if (failures < (uint8)0xff) {
+        ++failures;
+    }
+    registry->failures[handle] = failures;
+    ++registry->timeouts[handle];
+    if (failures >= GB_CFG_QUARANTINE_AFTER) {
+        shift = (uint8)(failures - GB_CFG_QUARANTINE_AFTER + 1);
+        if (shift > GB_CFG_QUARANTINE_MAX_SHIFT) {
+            shift = GB_CFG_QUARANTINE_MAX_SHIFT;
+        }
+        registry->state[handle] = (uint8)GB_SLAVE_QUARANTINED;
+    } else {
+        registry->state[handle] = (uint8)GB_SLAVE_SUSPECT;
+    }
+    registry->nextDue[handle] = GB_TICKS(now + ((uint32)registry->interval[handle] << shift));
+}
+
+/*!
+ *  Reply timeout for the next request to a slave: srtt + 4 * rttVar once it answered,
+ *  GB_CFG_REPLY_TIMEOUT before.
+ */
+uint16 Gb_Registry_ReplyTimeout(Gb_RegistryType const * registry, uint16 handle)
+{
+    uint32 timeout;
+
+    if (registry->srtt[handle] == (uint16)0) {
+        return (uint16)GB_CFG_REPLY_TIMEOUT;
+    }
+    timeout = ((uint32)registry->srtt[handle] >> 3) + registry->rttVar[handle];
+    return (timeout > 0xffffu) ? (uint16)0xffffu : (uint16)(timeout ? timeout : 1u);
+}
+
+void Gb_Registry_SetIdentity(Gb_RegistryType * registry, uint16 handle, uint8 unitFamily, uint8 unitType)
+{
+    registry->unitFamily[handle] = unitFamily;
+    registry->unitType[handle] = unitType;
+}
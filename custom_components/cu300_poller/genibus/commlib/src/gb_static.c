@@ -0,0 +1,246 @@
+/*
+ *  Grundfos GENIBus Library.
+ *
+ *  (C) 2007-2016 by Christoph Schueler <github.com/Christoph2,
+ *                                       cpu12.gems@googlemail.com>
+ *
+ *   All Rights Reserved
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+
+#include "genibus/gb_static.h"
+#include "genibus/gb_registry.h"
+
+/*
+** Everything the static profile owns lives in Gb_State. The slave registry is
+** allocated by the application, but it is part of the profile, so one registry
+** of GB_CFG_REGISTRY_SIZE entries is added to get the RAM footprint that is
+** checked against GB_CFG_RAM_BUDGET below.
+*/
+
+#define GB_NO_FRAME         ((uint8)0xff)
+
+typedef enum tagGb_RxType {
+    GB_RX_NONE,
+    GB_RX_FRAME,
+    GB_RX_CRC_ERROR
+} Gb_RxType;
+
+typedef struct tagGb_StateType {
+    DatalinkLayerType link;
+    Interface * port;
+    Gb_ReplyCallout callout;
+    uint32 sentAt;
+    Gb_FrameType frames[GB_CFG_FRAME_POOL_SIZE];
+    Gb_SlaveType slaves[GB_CFG_MAX_SLAVES];
+    uint8 freeList[GB_CFG_FRAME_POOL_SIZE];
+    uint8 queue[GB_CFG_TX_QUEUE_LEN];
+    uint8 freeCount;
+    uint8 queueHead;
+    uint8 queueCount;
+    uint8 slaveCount;
+    uint8 sourceAddress;
+    uint8 current;
+    uint8 rx;
+} Gb_StateType;
+
+#define GB_FOOTPRINT        (sizeof(Gb_StateType) + sizeof(Gb_RegistryType))
+
+/* Fails to compile if the configuration exceeds the RAM budget. */
+typedef char Gb_RamBudgetCheck[(GB_FOOTPRINT <= GB_CFG_RAM_BUDGET) ? 1 : -1];
+
+static Gb_StateType Gb_State;
+
+const SizeType Gb_StaticFootprint = GB_FOOTPRINT;
+
+static void Gb_FrameReceived(uint8 * buffer, uint8 len);
+static void Gb_FrameError(Gb_Error error, uint8 * buffer, uint8 len);
+static sint16 Gb_FindSlave(uint8 address);
+static void Gb_Complete(Gb_ResultType result, uint8 const * frame, uint8 len);
+
+
+void Gb_Init(Interface * port, uint8 sourceAddress, Gb_ReplyCallout callout)
+{
+    uint8 idx;
+
+    Gb_State.port = port;
+    Gb_State.callout = callout;
+    Gb_State.sourceAddress = sourceAddress;
+    Gb_State.link.port = port;
+    Gb_State.link.dataLinkCallout = Gb_FrameReceived;
+    Gb_State.link.errorCallout = Gb_FrameError;
+    LinkLayer_Init(&Gb_State.link);
+
+    for (idx = (uint8)0; idx < GB_CFG_FRAME_POOL_SIZE; ++idx) {
+        Gb_State.freeList[idx] = idx;
+    }
+    Gb_State.freeCount = GB_CFG_FRAME_POOL_SIZE;
+    Gb_State.queueHead = (uint8)0;
+    Gb_State.queueCount = (uint8)0;
+    Gb_State.slaveCount = (uint8)0;
+    Gb_State.current = GB_NO_FRAME;
+    Gb_State.rx = GB_RX_NONE;
+}
+
+Gb_StatusType Gb_AddSlave(uint8 address)
+{
+    Gb_SlaveType * slave;
+
+    if (Gb_FindSlave(address) >= 0) {
+        return GB_OK;
+    }
+    if (Gb_State.slaveCount >= GB_CFG_MAX_SLAVES) {
+        return GB_E_FULL;
+    }
+    slave = &Gb_State.slaves[Gb_State.slaveCount++];
+    slave->address = address;
+    slave->pending = (uint8)0;
+    slave->replies = (uint16)0;
+    slave->timeouts = (uint16)0;
+    slave->crcErrors = (uint16)0;
+    return GB_OK;
+}
+
+Gb_SlaveType const * Gb_GetSlave(uint8 address)
+{
+    sint16 idx = Gb_FindSlave(address);
+
+    return (idx < 0) ? (Gb_SlaveType const *)NULL : &Gb_State.slaves[idx];
+}
+
+/*!
+ *  Queue a request telegram carrying `apdus`; it goes out from a later Gb_Poll().
+ */
+Gb_StatusType Gb_Submit(uint8 address, uint8 const * apdus, uint8 len)
+{
+    sint16 slave;
+    uint8 idx;
+    Gb_FrameType * frame;
+
+    slave = Gb_FindSlave(address);
+    if (slave < 0) {
+        return GB_E_UNKNOWN_SLAVE;
+    }
+    if ((Gb_State.freeCount == (uint8)0) || (Gb_State.queueCount >= GB_CFG_TX_QUEUE_LEN)) {
+        return GB_E_FULL;
+    }
+    idx = Gb_State.freeList[Gb_State.freeCount - 1];
+    frame = &Gb_State.frames[idx];
+    frame->length = LinkLayer_BuildFrame(frame->data, GB_SD_REQUEST, address, Gb_State.sourceAddress, apdus, len);
+    if (frame->length == (uint8)0) {
+        return GB_E_LENGTH;
+    }
+    --Gb_State.freeCount;
+    frame->slave = (uint8)slave;
+    ++Gb_State.slaves[slave].pending;
+    Gb_State.queue[(Gb_State.queueHead + Gb_State.queueCount) % GB_CFG_TX_QUEUE_LEN] = idx;
+    ++Gb_State.queueCount;
+    return GB_OK;
+}
+
+/*!
+ *  Advance the bus state machine; `now` is a free-running tick counter
+ *  (the unit of GB_CFG_REPLY_TIMEOUT), wrap-around is handled.
+ */
+void Gb_Poll(uint32 now)
+{
+    uint8 const * buffer = Gb_State.link.scratchBuffer;
+    uint8 idx;
+
+    if (Gb_State.current != GB_NO_FRAME) {
+        Gb_State.rx = GB_RX_NONE;
+        (void)LinkLayer_Process(&Gb_State.link, (uint16)GB_CFG_RX_BYTES_PER_POLL);
+        if ((Gb_State.rx == GB_RX_FRAME) &&
+            (buffer[3] == Gb_State.slaves[Gb_State.frames[Gb_State.current].slave].address)) {
+            Gb_Complete(GB_RESULT_REPLY, buffer, Gb_State.link.frameLength);
+        } else if (Gb_State.rx == GB_RX_CRC_ERROR) {
+            Gb_Complete(GB_RESULT_CRC, buffer, Gb_State.link.frameLength);
+        } else if ((uint32)(now - Gb_State.sentAt) >= (uint32)GB_CFG_REPLY_TIMEOUT) {
+            LinkLayer_Reset(&Gb_State.link);
+            Gb_Complete(GB_RESULT_TIMEOUT, (uint8 const *)NULL, (uint8)0);
+        }
+    }
+
+    if ((Gb_State.current == GB_NO_FRAME) && (Gb_State.queueCount > (uint8)0)) {
+        idx = Gb_State.queue[Gb_State.queueHead];
+        Gb_State.queueHead = (Gb_State.queueHead + 1) % GB_CFG_TX_QUEUE_LEN;
+        --Gb_State.queueCount;
+        Gb_State.current = idx;
+        Gb_State.sentAt = now;
+        LinkLayer_Reset(&Gb_State.link);
+        Gb_State.port->writeFrame(Gb_State.frames[idx].data, Gb_State.frames[idx].length);
+    }
+}
+
+boolean Gb_Idle(void)
+{
+    return (Gb_State.current == GB_NO_FRAME) && (Gb_State.queueCount == (uint8)0);
+}
+
+static void Gb_FrameReceived(uint8 * buffer, uint8 len)
+{
+    (void)buffer;
+    (void)len;
+    Gb_State.rx = GB_RX_FRAME;
+}
+
+static void Gb_FrameError(Gb_Error error, uint8 * buffer, uint8 len)
+{
+    (void)buffer;
+    (void)len;
+    if (error == ERR_INVALID_CRC) {
+        Gb_State.rx = GB_RX_CRC_ERROR;
+    }
+}
+
+static sint16 Gb_FindSlave(uint8 address)
+{
+    uint8 idx;
+
+    for (idx = (uint8)0; idx < Gb_State.slaveCount; ++idx) {
+        if (Gb_State.slaves[idx].address == address) {
+            return (sint16)idx;
+        }
+    }
+    return (sint16)-1;
+}
+
+static void Gb_Complete(Gb_ResultType result, uint8 const * frame, uint8 len)
+{
+    uint8 idx = Gb_State.current;
+    Gb_SlaveType * slave = &Gb_State.slaves[Gb_State.frames[idx].slave];
+
+    switch (result) {
+        case GB_RESULT_REPLY:
+            ++slave->replies;
+            break;
+        case GB_RESULT_TIMEOUT:
+            ++slave->timeouts;
+            break;
+        case GB_RESULT_CRC:
+            ++slave->crcErrors;
+            break;
+    }
+    --slave->pending;
+    Gb_State.freeList[Gb_State.freeCount++] = idx;
+    Gb_State.current = GB_NO_FRAME;
+    if (Gb_State.callout != NULL) {
+        Gb_State.callout(slave->address, result, frame, len);
+    }
+}
@@ -0,0 +1,228 @@
+/*
+ *  Grundfos GENIBus Library.
+ *
+ * (C) 2007-2016 by Christoph Schueler <github.com/Christoph2,
+ *                                      cpu12.gems@googlemail.com>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "genibus/posix_rt.h"
+
+#define NSEC_PER_SEC    (1000000000L)
+#define NSEC_PER_USEC   (1000L)
+
+void Win_Error(char * function, uint32_t err);
+
+static void Rt_PrefaultStack(void);
+static uint8 Rt_Bucket(uint32 us);
+static void Rt_Lock(void);
+static void Rt_Unlock(void);
+static void Rt_InitLock(void);
+
+/* Written only by the bus thread; readers take a snapshot with Port_Rt_GetJitter(). */
+static Port_Rt_JitterType Rt_Jitter = { {0}, 0, 0xffffffffUL, 0, 0 };
+/*
+** Priority inheritance: the SCHED_FIFO bus thread takes this lock on every
+** transmit, and must not wait behind a low-priority reader that got preempted
+** while holding it.
+*/
+static pthread_mutex_t Rt_JitterLock;
+static pthread_once_t Rt_JitterLockOnce = PTHREAD_ONCE_INIT;
+
+
+uint8 Port_Rt_Init(Port_Rt_ConfigType const * config)
+{
+    uint8 result = (uint8)0;
+    int err;
+    cpu_set_t cpus;
+    struct sched_param param;
+
+    if (config->cpu >= 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(config->cpu, &cpus);
+        /* The pthread functions return the error instead of setting errno. */
+        err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (err != 0) {
+            Win_Error("pthread_setaffinity_np", (uint32_t)err);
+            result |= PORT_RT_ERR_AFFINITY;
+        }
+    }
+
+    if (config->lockMemory) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == -1) {
+            Win_Error("mlockall", errno);
+            result |= PORT_RT_ERR_MLOCK;
+        }
+    }
+    Rt_PrefaultStack();
+
+    if (config->priority > 0) {
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = config->priority;
+        err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0) {
+            Win_Error("pthread_setschedparam", (uint32_t)err);
+            result |= PORT_RT_ERR_SCHEDULER;
+        }
+    }
+
+    Port_Rt_ResetJitter();
+    return result;
+}
+
+/*!
+ *  Absolute CLOCK_MONOTONIC deadline `offsetUs` from now.
+ */
+void Port_Rt_Deadline(struct timespec * deadline, uint32 offsetUs)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_nsec += (long)(offsetUs % 1000000UL) * NSEC_PER_USEC;
+    deadline->tv_sec += (time_t)(offsetUs / 1000000UL);
+    if (deadline->tv_nsec >= NSEC_PER_SEC) {
+        deadline->tv_nsec -= NSEC_PER_SEC;
+        ++deadline->tv_sec;
+    }
+}
+
+/*!
+ *  Sleep until `deadline`, send the frame and record how late it went out.
+ */
+boolean Port_Rt_TransmitAt(struct timespec const * deadline, Interface const * port, uint8 const * buffer, uint16 len)
+{
+    struct timespec actual;
+    int result;
+
+    do {
+        result = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL);
+    } while (result == EINTR);
+
+    clock_gettime(CLOCK_MONOTONIC, &actual);
+    Port_Rt_RecordJitter(deadline, &actual);
+
+    return port->writeFrame(buffer, len) != (uint8)0;
+}
+
+void Port_Rt_RecordJitter(struct timespec const * scheduled, struct timespec const * actual)
+{
+    long long deltaNs;
+    uint32 us;
+
+    deltaNs = (long long)(actual->tv_sec - scheduled->tv_sec) * NSEC_PER_SEC + (actual->tv_nsec - scheduled->tv_nsec);
+    us = (deltaNs <= 0) ? 0UL : ((deltaNs / NSEC_PER_USEC) > 0xffffffffLL) ? 0xffffffffUL : (uint32)(deltaNs / NSEC_PER_USEC);
+
+    Rt_Lock();
+    ++Rt_Jitter.buckets[Rt_Bucket(us)];
+    ++Rt_Jitter.count;
+    Rt_Jitter.sumUs += us;
+    Rt_Jitter.minUs = MIN(Rt_Jitter.minUs, us);
+    Rt_Jitter.maxUs = MAX(Rt_Jitter.maxUs, us);
+    Rt_Unlock();
+}
+
+void Port_Rt_GetJitter(Port_Rt_JitterType * jitter)
+{
+    Rt_Lock();
+    *jitter = Rt_Jitter;
+    Rt_Unlock();
+}
+
+void Port_Rt_ResetJitter(void)
+{
+    Rt_Lock();
+    memset(&Rt_Jitter, 0, sizeof(Rt_Jitter));
+    Rt_Jitter.minUs = 0xffffffffUL;
+    Rt_Unlock();
+}
+
+void Port_Rt_DumpJitter(void)
+{
+    Port_Rt_JitterType jitter;
+    uint8 idx;
+
+    Port_Rt_GetJitter(&jitter);
+    if (jitter.count == 0) {
+        printf("TX jitter: no samples.\n");
+        return;
+    }
+    printf("TX jitter: %lu samples, min %luus, mean %luus, max %luus\n",
+        (unsigned long)jitter.count, (unsigned long)jitter.minUs,
+        (unsigned long)(jitter.sumUs / jitter.count), (unsigned long)jitter.maxUs
+    );
+    for (idx = 0; idx < GB_RT_JITTER_BUCKETS; ++idx) {
+        if (jitter.buckets[idx] == 0) {
+            continue;
+        }
+        if (idx == (GB_RT_JITTER_BUCKETS - 1)) {
+            printf("  >= %8luus: %lu\n", idx ? (1UL << (idx - 1)) : 0UL, (unsigned long)jitter.buckets[idx]);
+        } else {
+            printf("  < %9luus: %lu\n", 1UL << idx, (unsigned long)jitter.buckets[idx]);
+        }
+    }
+}
+
+static void Rt_InitLock(void)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+    pthread_mutex_init(&Rt_JitterLock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static void Rt_Lock(void)
+{
+    pthread_once(&Rt_JitterLockOnce, Rt_InitLock);
+    pthread_mutex_lock(&Rt_JitterLock);
+}
+
+static void Rt_Unlock(void)
+{
+    pthread_mutex_unlock(&Rt_JitterLock);
+}
+
+static void Rt_PrefaultStack(void)
+{
+    volatile uint8 stack[GB_RT_STACK_PREFAULT];
+
+    memset((void *)stack, 0, sizeof(stack));
+}
+
+/* Bucket 0: < 1us, bucket n: [2^(n-1), 2^n) us, the last one collects everything above. */
+static uint8 Rt_Bucket(uint32 us)
+{
+    uint8 bucket = (uint8)0;
+
+    while ((us > 0) && (bucket < (GB_RT_JITTER_BUCKETS - 1))) {
+        us >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
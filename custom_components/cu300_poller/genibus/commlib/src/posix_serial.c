@@ -37,6 +37,7 @@
 #include <unistd.h>
 
 #include "genibus/posix_serial.h"
+#include "genibus/posix_rt.h"
 
 #if defined(HAVE_POLL_H)
 
@@ -44,6 +45,16 @@
 
 #define FLUSH_TRANSMITTER   1
 
+#if !defined(VOID_EXPRESSION)
+    #define VOID_EXPRESSION()   ((void)0)
+#endif
+
+#if defined(GB_SERIAL_DEBUG)
+    #define SERIAL_DBG(...)     printf(__VA_ARGS__)
+#else
+    #define SERIAL_DBG(...)     VOID_EXPRESSION()
+#endif
+
 #if (defined(__CYGWIN__) && !defined(_WIN32)) || defined(__linux__)
     // Cygwin POSIX under Microsoft Windows.and Linux.
     #define DEVICE_NAME "/dev/ttyS%u"
@@ -56,9 +67,12 @@ static uint16_t Serial_BytesWaiting(Port_Serial_ComPortType const * port, uint32
 static boolean Serial_Write(Port_Serial_ComPortType * port, uint8_t const * buffer, uint32_t byteCount);
 static boolean Serial_WriteByte(Port_Serial_ComPortType * port, uint8_t byteToWrite);
 static PollingResultType Serial_Poll(Port_Serial_ComPortType * port, boolean writing, uint16_t * events);
+static uint8 Serial_WriteFrame(uint8 const * const buffer, uint16 len);
 
 
 static Port_Serial_ComPortType ComPort;
+/* Transmit side only, for the real-time mode (Port_Serial_WriteAt()). */
+static Interface const Serial_RtPort = { Serial_WriteFrame, NULL, NULL };
 
 
 static PollingResultType Serial_Poll(Port_Serial_ComPortType * port, boolean writing, uint16_t * events)
@@ -101,24 +115,47 @@ static uint16_t Serial_BytesWaiting(Port_Serial_ComPortType const * port, uint32
 
 static boolean Serial_Write(Port_Serial_ComPortType * port, uint8_t const * buffer, uint32_t byteCount)
 {
-    int result;
+    ssize_t result;
     PollingResultType pollingResult;
     uint16_t events;
 
-    result = write(port->fd, buffer, byteCount);
+    /*
+    ** The descriptor is non-blocking, so a frame normally leaves in a single write();
+    ** only fall back to poll() if the driver's transmit queue is actually full.
+    */
+    while (byteCount > 0) {
+        result = write(port->fd, buffer, byteCount);
+        if (result == -1) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN) {
+                pollingResult = Serial_Poll(port, TRUE, &events);
+                if ((pollingResult == POLLING_OK) || (pollingResult == POLLING_INTERRUPTED)) {
+                    continue;
+                }
+            } else {
+                Win_Error("write", errno);
+            }
+            return FALSE;
+        }
+        buffer += result;
+        byteCount -= (uint32_t)result;
+    }
 #if defined(FLUSH_TRANSMITTER) && FLUSH_TRANSMITTER == 1
+    /* tcdrain() already blocks until the last stop bit is out, no need to poll() for POLLOUT afterwards. */
     tcdrain(port->fd);
 #endif
 
-    pollingResult = Serial_Poll(port, TRUE, &events);
-    if (pollingResult == POLLING_OK) {
-        //printf("Poll-Events: %02x\n", events);
-    }
-
     return TRUE;
 }
 
 
+static uint8 Serial_WriteFrame(uint8 const * const buffer, uint16 len)
+{
+    return Serial_Write(&ComPort, buffer, len) ? (uint8)1 : (uint8)0;
+}
+
+
 static boolean Serial_OpenPort(Port_Serial_ComPortType * port, uint16_t nBaudRate,uint8_t nParity, uint8_t nDataBits, uint8_t nStopBits)
 {
     //int fd;
@@ -230,6 +267,15 @@ boolean Port_Serial_Write(uint8_t const * buffer, uint32_t byteCount)
     return Serial_Write(&ComPort, buffer, byteCount);
 }
 
+/*!
+ *  Send the frame at an absolute CLOCK_MONOTONIC deadline and record its
+ *  lateness in the jitter histogram (see posix_rt.h, Port_Rt_Init()).
+ */
+boolean Port_Serial_WriteAt(struct timespec const * deadline, uint8_t const * buffer, uint16_t byteCount)
+{
+    return Port_Rt_TransmitAt(deadline, &Serial_RtPort, buffer, byteCount);
+}
+
 PollingResultType Port_Serial_Poll(boolean writing, uint16_t * events)
 {
 
@@ -251,9 +297,7 @@ void Port_Serial_Task(void)
     uint8_t buffer[128];
     PollingResultType pollingResult;
     uint16_t events;
-    uint32_t errors;
-    int result;
-    int byteCount;
+    ssize_t result;
     int idx;
 
     pollingResult = Port_Serial_Poll(FALSE, &events);
@@ -261,21 +305,35 @@ void Port_Serial_Task(void)
     if (pollingResult ==  POLLING_ERROR) {
         Win_Error("read", errno);
     } else if (pollingResult == POLLING_OK) {
-        printf("Polling events: %04X\n", events);
-        byteCount = Port_Serial_BytesWaiting(&errors);
-        printf("Bytes waiting: %u\n", byteCount);
-        result = Port_Serial_Read(buffer, byteCount);
-        printf("Read-Result: %02x\n", result);
-        if (result == -1) {
-            Win_Error("read", errno);
-        } else {
-            Dbg_DumpHex(buffer, byteCount);
-            for (idx = 0; idx < byteCount; ++idx) {
+        SERIAL_DBG("Polling events: %04X\n", events);
+        /*
+        ** No TIOCINQ round-trip: the descriptor is non-blocking, so just drain
+        ** it into the buffer until the driver has nothing more to give.
+        */
+        for (;;) {
+            result = read(ComPort.fd, buffer, sizeof(buffer));
+            if (result == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN) {
+                    Win_Error("read", errno);
+                }
+                break;
+            }
+            SERIAL_DBG("Read-Result: %02x\n", (unsigned)result);
+#if defined(GB_SERIAL_DEBUG)
+            Dbg_DumpHex(buffer, result);
+#endif
+            for (idx = 0; idx < result; ++idx) {
                 KnxLL_FeedReceiver(buffer[idx]);
             }
+            if (result < (ssize_t)sizeof(buffer)) {
+                break;
+            }
         }
     } else if (pollingResult == POLLING_TIMEOUT) {
-        printf("Timeout.\n");
+        SERIAL_DBG("Timeout.\n");
     } else {
     }
 }
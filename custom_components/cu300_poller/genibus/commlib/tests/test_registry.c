@@ -0,0 +1,199 @@
+/*
+ *  Grundfos GENIBus Library.
+ *
+ *  (C) 2007-2016 by Christoph Schueler <github.com/Christoph2,
+ *                                       cpu12.gems@googlemail.com>
+ *
+ *   All Rights Reserved
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+
+/*
+** Host-side check of the slave registry: the fixed-point RTT estimator, due
+** times across the 2^32 tick wrap, the capped quarantine back-off, the table
+** limit and re-adding a known slave.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "genibus/gb_registry.h"
+
+static Gb_RegistryType Test_Registry;
+static int Test_Failures;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            ++Test_Failures;                                            \
+        }                                                               \
+    } while (0)
+
+
+static boolean Test_IsDue(uint32 now, uint16 handle)
+{
+    uint16 handles[GB_CFG_REGISTRY_SIZE];
+    uint16 found;
+    uint16 idx;
+
+    found = Gb_Registry_Due(&Test_Registry, now, handles, (uint16)GB_CFG_REGISTRY_SIZE);
+    for (idx = (uint16)0; idx < found; ++idx) {
+        if (handles[idx] == handle) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static void Test_Rtt(void)
+{
+    sint16 handle;
+
+    Gb_Registry_Init(&Test_Registry);
+    handle = Gb_Registry_Add(&Test_Registry, (uint8)0, (uint8)0x20, (uint16)100, (uint32)0);
+    CHECK(handle == 0);
+    CHECK(Gb_Registry_ReplyTimeout(&Test_Registry, (uint16)handle) == (uint16)GB_CFG_REPLY_TIMEOUT);
+
+    /* First sample: srtt = rtt, rttVar = rtt / 2 (scaled by 8 and 4). */
+    Gb_Registry_Reply(&Test_Registry, (uint16)handle, (uint32)1000, (uint16)100);
+    CHECK(Test_Registry.srtt[handle] == (uint16)800);
+    CHECK(Test_Registry.rttVar[handle] == (uint16)200);
+    CHECK(Gb_Registry_ReplyTimeout(&Test_Registry, (uint16)handle) == (uint16)300);
+    CHECK(Test_Registry.nextDue[handle] == (uint32)1100);
+    CHECK(Test_Registry.lastSeen[handle] == (uint32)1000);
+
+    /* srtt += (140 - 100) / 8, rttVar += (40 - 50) / 4. */
+    Gb_Registry_Reply(&Test_Registry, (uint16)handle, (uint32)1100, (uint16)140);
+    CHECK(Test_Registry.srtt[handle] == (uint16)840);
+    CHECK(Test_Registry.rttVar[handle] == (uint16)190);
+    CHECK(Gb_Registry_ReplyTimeout(&Test_Registry, (uint16)handle) == (uint16)295);
+
+    /* A faster reply: the deviation counts with its absolute value. */
+    Gb_Registry_Reply(&Test_Registry, (uint16)handle, (uint32)1200, (uint16)60);
+    CHECK(Test_Registry.srtt[handle] == (uint16)795);
+    CHECK(Test_Registry.rttVar[handle] == (uint16)188);
+    CHECK(Gb_Registry_ReplyTimeout(&Test_Registry, (uint16)handle) == (uint16)287);
+    CHECK(Test_Registry.replies[handle] == (uint16)3);
+
+    /* Saturates instead of wrapping. */
+    handle = Gb_Registry_Add(&Test_Registry, (uint8)0, (uint8)0x21, (uint16)100, (uint32)0);
+    Gb_Registry_Reply(&Test_Registry, (uint16)handle, (uint32)0, (uint16)0xffff);
+    CHECK(Test_Registry.srtt[handle] == (uint16)0xffff);
+    CHECK(Test_Registry.rttVar[handle] == (uint16)0xffff);
+    CHECK(Gb_Registry_ReplyTimeout(&Test_Registry, (uint16)handle) == (uint16)0xffff);
+}
+
+static void Test_Wrap(void)
+{
+    sint16 handle;
+
+    Gb_Registry_Init(&Test_Registry);
+    handle = Gb_Registry_Add(&Test_Registry, (uint8)0, (uint8)0x20, (uint16)0x20, (uint32)0xfffffff0UL);
+    CHECK(Test_IsDue((uint32)0xfffffff0UL, (uint16)handle));
+
+    /* Next due at 0x10, past the wrap: not due before, due from there on. */
+    Gb_Registry_Reply(&Test_Registry, (uint16)handle, (uint32)0xfffffff0UL, (uint16)5);
+    CHECK(Test_Registry.nextDue[handle] == (uint32)0x10);
+    CHECK(!Test_IsDue((uint32)0xfffffff0UL, (uint16)handle));
+    CHECK(!Test_IsDue((uint32)0xffffffffUL, (uint16)handle));
+    CHECK(!Test_IsDue((uint32)0x0f, (uint16)handle));
+    CHECK(Test_IsDue((uint32)0x10, (uint16)handle));
+    CHECK(Test_IsDue((uint32)0x1000, (uint16)handle));
+}
+
+static void Test_Quarantine(void)
+{
+    sint16 handle;
+    uint32 now = (uint32)0;
+    unsigned missed;
+    uint8 shift;
+
+    Gb_Registry_Init(&Test_Registry);
+    handle = Gb_Registry_Add(&Test_Registry, (uint8)0, (uint8)0x20, (uint16)10, now);
+    for (missed = 1U; missed <= 300U; ++missed) {
+        Gb_Registry_Timeout(&Test_Registry, (uint16)handle, now);
+        if (missed < GB_CFG_QUARANTINE_AFTER) {
+            CHECK(Test_Registry.state[handle] == (uint8)GB_SLAVE_SUSPECT);
+            CHECK(Test_Registry.nextDue[handle] == now + 10UL);
+        } else {
+            shift = (uint8)MIN(missed - GB_CFG_QUARANTINE_AFTER + 1U, (unsigned)GB_CFG_QUARANTINE_MAX_SHIFT);
+            CHECK(Test_Registry.state[handle] == (uint8)GB_SLAVE_QUARANTINED);
+            CHECK(Test_Registry.nextDue[handle] == now + (10UL << shift));
+        }
+        now += (uint32)1000;
+    }
+    /* The failure counter saturates, the back-off stays at its cap. */
+    CHECK(Test_Registry.failures[handle] == (uint8)0xff);
+    CHECK(Test_Registry.timeouts[handle] == (uint16)300);
+    CHECK(Test_Registry.nextDue[handle] == now - 1000UL + (10UL << GB_CFG_QUARANTINE_MAX_SHIFT));
+
+    Gb_Registry_Reply(&Test_Registry, (uint16)handle, now, (uint16)5);
+    CHECK(Test_Registry.state[handle] == (uint8)GB_SLAVE_ACTIVE);
+    CHECK(Test_Registry.failures[handle] == (uint8)0);
+    CHECK(Test_Registry.nextDue[handle] == now + 10UL);
+}
+
+static void Test_Limit(void)
+{
+    uint16 idx;
+
+    Gb_Registry_Init(&Test_Registry);
+    for (idx = (uint16)0; idx < (uint16)GB_CFG_REGISTRY_SIZE; ++idx) {
+        CHECK(Gb_Registry_Add(&Test_Registry, (uint8)(idx >> 8), (uint8)idx, (uint16)10, (uint32)0) == (sint16)idx);
+    }
+    CHECK(Test_Registry.count == (uint16)GB_CFG_REGISTRY_SIZE);
+    CHECK(Gb_Registry_Add(&Test_Registry, (uint8)0xff, (uint8)0xff, (uint16)10, (uint32)0) == GB_REGISTRY_NONE);
+    CHECK(Test_Registry.count == (uint16)GB_CFG_REGISTRY_SIZE);
+    /* A known slave is still found when the table is full. */
+    CHECK(Gb_Registry_Add(&Test_Registry, (uint8)0, (uint8)0, (uint16)20, (uint32)0) == 0);
+    CHECK(Test_Registry.interval[0] == (uint16)20);
+}
+
+static void Test_Duplicates(void)
+{
+    sint16 handle;
+
+    Gb_Registry_Init(&Test_Registry);
+    handle = Gb_Registry_Add(&Test_Registry, (uint8)0, (uint8)0x20, (uint16)10, (uint32)0);
+    Gb_Registry_Reply(&Test_Registry, (uint16)handle, (uint32)5, (uint16)3);
+
+    /* Same bus and address: same handle, new interval, state kept. */
+    CHECK(Gb_Registry_Add(&Test_Registry, (uint8)0, (uint8)0x20, (uint16)50, (uint32)7) == handle);
+    CHECK(Test_Registry.count == (uint16)1);
+    CHECK(Test_Registry.interval[handle] == (uint16)50);
+    CHECK(Test_Registry.nextDue[handle] == (uint32)15);
+    CHECK(Test_Registry.replies[handle] == (uint16)1);
+
+    /* The same address on another bus is another slave. */
+    CHECK(Gb_Registry_Add(&Test_Registry, (uint8)1, (uint8)0x20, (uint16)10, (uint32)0) == 1);
+    CHECK(Gb_Registry_Find(&Test_Registry, (uint8)1, (uint8)0x20) == 1);
+    CHECK(Gb_Registry_Find(&Test_Registry, (uint8)0, (uint8)0x20) == handle);
+    CHECK(Gb_Registry_Find(&Test_Registry, (uint8)2, (uint8)0x20) == GB_REGISTRY_NONE);
+}
+
+int main(void)
+{
+    Test_Rtt();
+    Test_Wrap();
+    Test_Quarantine();
+    Test_Limit();
+    Test_Duplicates();
+    return (Test_Failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,218 @@
+/*
+ *  Grundfos GENIBus Library.
+ *
+ *  (C) 2007-2016 by Christoph Schueler <github.com/Christoph2,
+ *                                       cpu12.gems@googlemail.com>
+ *
+ *   All Rights Reserved
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+
+/*
+** Host-side check of the real-time transmit path (hosted profile only).
+**
+** First the histogram itself: known lateness values must land in the right
+** log2 buckets. Then a stress run: TEST_RT_FRAMES frames are sent through
+** Port_Rt_TransmitAt() at a fixed period while one busy thread per CPU loads
+** the machine. No frame may leave before its deadline, and every frame must
+** be counted exactly once. The histogram is always printed.
+**
+** Port_Rt_Init() pins to CPU 0 and locks memory; GB_TEST_RT_PRIORITY selects a
+** SCHED_FIFO priority (needs CAP_SYS_NICE). Steps that fail for lack of
+** privileges are reported, not fatal. GB_TEST_MAX_JITTER_US turns the worst
+** lateness into a hard limit.
+*/
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "genibus/posix_rt.h"
+
+#define TEST_RT_FRAMES      (500U)
+#define TEST_RT_PERIOD_US   (1000UL)
+#define TEST_RT_MAX_LOAD    (64)
+
+static struct timespec const * Test_Deadline;
+static unsigned Test_Sent;
+static unsigned Test_Early;
+static int Test_Failures;
+static volatile int Test_Loaded;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            ++Test_Failures;                                            \
+        }                                                               \
+    } while (0)
+
+
+void Win_Error(char * function, uint32_t err)
+{
+    printf("%s: error %lu\n", function, (unsigned long)err);
+}
+
+static uint8 Test_WriteFrame(uint8 const * const buf, uint16 len)
+{
+    struct timespec now;
+
+    (void)buf;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((now.tv_sec < Test_Deadline->tv_sec) ||
+        ((now.tv_sec == Test_Deadline->tv_sec) && (now.tv_nsec < Test_Deadline->tv_nsec))) {
+        ++Test_Early;
+    }
+    ++Test_Sent;
+    return (uint8)len;
+}
+
+static void * Test_Load(void * arg)
+{
+    volatile unsigned long spins = 0UL;
+
+    (void)arg;
+    while (Test_Loaded) {
+        ++spins;
+    }
+    return NULL;
+}
+
+/* `us` microseconds (plus `ns` nanoseconds) late against a fixed schedule. */
+static void Test_Record(uint32 us, long ns)
+{
+    struct timespec scheduled = { 100, 500000000L };
+    struct timespec actual = scheduled;
+
+    actual.tv_sec += (time_t)(us / 1000000UL);
+    actual.tv_nsec += (long)(us % 1000000UL) * 1000L + ns;
+    while (actual.tv_nsec >= 1000000000L) {
+        actual.tv_nsec -= 1000000000L;
+        ++actual.tv_sec;
+    }
+    while (actual.tv_nsec < 0L) {
+        actual.tv_nsec += 1000000000L;
+        --actual.tv_sec;
+    }
+    Port_Rt_RecordJitter(&scheduled, &actual);
+}
+
+static void Test_Buckets(void)
+{
+    Port_Rt_JitterType jitter;
+
+    Port_Rt_ResetJitter();
+    Test_Record(0UL, -2000L);                       /* Early counts as on time. */
+    Test_Record(0UL, 999L);                         /* < 1us */
+    Test_Record(1UL, 0L);                           /* [1, 2us) */
+    Test_Record(3UL, 0L);                           /* [2, 4us) */
+    Test_Record(1000UL, 0L);                        /* [512, 1024us) */
+    Test_Record(3600UL * 1000000UL, 0L);            /* Way beyond the last bucket. */
+    Port_Rt_GetJitter(&jitter);
+
+    CHECK(jitter.count == 6UL);
+    CHECK(jitter.buckets[0] == 2UL);
+    CHECK(jitter.buckets[1] == 1UL);
+    CHECK(jitter.buckets[2] == 1UL);
+    CHECK(jitter.buckets[10] == 1UL);
+    CHECK(jitter.buckets[GB_RT_JITTER_BUCKETS - 1] == 1UL);
+    CHECK(jitter.minUs == 0UL);
+    CHECK(jitter.maxUs == 3600UL * 1000000UL);
+    CHECK(jitter.sumUs == (uint64_t)1004UL + (uint64_t)3600UL * 1000000UL);
+}
+
+static void Test_Stress(void)
+{
+    static uint8 const frame[] = { 0x27, 0x07, 0x20, 0x04, 0x02, 0xc3, 0x02, 0x10, 0x1a, 0x5c, 0x4e };
+    Interface port = { Test_WriteFrame, NULL, NULL };
+    Port_Rt_ConfigType config = { 0, 0, TRUE };
+    Port_Rt_JitterType jitter;
+    pthread_t load[TEST_RT_MAX_LOAD];
+    struct timespec deadline;
+    char const * value;
+    long cpus;
+    int threads = 0;
+    unsigned idx;
+    uint32 total = 0UL;
+    uint8 failed;
+
+    value = getenv("GB_TEST_RT_PRIORITY");
+    if (value != NULL) {
+        config.priority = (sint16)atoi(value);
+    }
+    failed = Port_Rt_Init(&config);
+    printf("real-time setup:%s%s%s%s\n",
+        (failed & PORT_RT_ERR_AFFINITY) ? " no-affinity" : "",
+        (failed & PORT_RT_ERR_SCHEDULER) ? " no-fifo" : "",
+        (failed & PORT_RT_ERR_MLOCK) ? " no-mlock" : "",
+        (failed == (uint8)0) ? " ok" : ""
+    );
+
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    Test_Loaded = 1;
+    while ((threads < cpus) && (threads < TEST_RT_MAX_LOAD)) {
+        if (pthread_create(&load[threads], NULL, Test_Load, NULL) != 0) {
+            break;
+        }
+        ++threads;
+    }
+
+    Port_Rt_Deadline(&deadline, (uint32)TEST_RT_PERIOD_US);
+    for (idx = 0U; idx < TEST_RT_FRAMES; ++idx) {
+        Test_Deadline = &deadline;
+        CHECK(Port_Rt_TransmitAt(&deadline, &port, frame, (uint16)sizeof(frame)) == TRUE);
+        deadline.tv_nsec += (long)TEST_RT_PERIOD_US * 1000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_nsec -= 1000000000L;
+            ++deadline.tv_sec;
+        }
+    }
+
+    Test_Loaded = 0;
+    while (threads > 0) {
+        pthread_join(load[--threads], NULL);
+    }
+
+    printf("%u frames every %luus, %ld busy threads:\n", TEST_RT_FRAMES, TEST_RT_PERIOD_US, cpus);
+    Port_Rt_DumpJitter();
+    Port_Rt_GetJitter(&jitter);
+    for (idx = 0U; idx < GB_RT_JITTER_BUCKETS; ++idx) {
+        total += jitter.buckets[idx];
+    }
+    CHECK(Test_Sent == TEST_RT_FRAMES);
+    CHECK(Test_Early == 0U);
+    CHECK(jitter.count == (uint32)TEST_RT_FRAMES);
+    CHECK(total == jitter.count);
+    CHECK(jitter.minUs <= jitter.maxUs);
+    value = getenv("GB_TEST_MAX_JITTER_US");
+    if (value != NULL) {
+        CHECK(jitter.maxUs <= (uint32)atol(value));
+    }
+}
+
+int main(void)
+{
+    Test_Buckets();
+    Test_Stress();
+    return (Test_Failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,201 @@
+/*
+ *  Grundfos GENIBus Library.
+ *
+ *  (C) 2007-2016 by Christoph Schueler <github.com/Christoph2,
+ *                                       cpu12.gems@googlemail.com>
+ *
+ *   All Rights Reserved
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+/*
+** Host-side check of the static profile: its RAM footprint against
+** GB_CFG_RAM_BUDGET, one request/reply round trip through Gb_Poll(), and the
+** cost of the per-byte receive path (LinkLayer_Process()).
+**
+** The receive path is timed with clock() over a long run of reply telegrams;
+** set GB_TEST_MAX_NS_PER_BYTE to turn the figure into a hard limit.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "genibus/gb_static.h"
+
+#define TEST_SLAVE          ((uint8)0x20)
+#define TEST_MASTER         ((uint8)0x04)
+#define TEST_TIMED_BYTES    (8UL * 1024UL * 1024UL)
+
+static uint8 Test_Rx[GB_CFG_FRAME_SIZE];
+static uint8 Test_RxLen;
+static uint8 Test_RxPos;
+static uint8 Test_Tx[GB_CFG_FRAME_SIZE];
+static uint16 Test_TxLen;
+static unsigned Test_Replies;
+static unsigned Test_Frames;
+static int Test_Failures;
+
+static uint8 Test_WriteFrame(uint8 const * const buf, uint16 len);
+static uint16 Test_Available(void);
+static uint8 Test_ReadByte(void);
+static uint16 Test_Repeating(void);
+static uint8 Test_ReadRepeating(void);
+
+static Interface Test_Port = { Test_WriteFrame, Test_Available, Test_ReadByte };
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);      \
+            ++Test_Failures;                                            \
+        }                                                               \
+    } while (0)
+
+
+static uint8 Test_WriteFrame(uint8 const * const buf, uint16 len)
+{
+    uint16 idx;
+
+    for (idx = (uint16)0; idx < len; ++idx) {
+        Test_Tx[idx] = buf[idx];
+    }
+    Test_TxLen = len;
+    return (uint8)len;
+}
+
+static uint16 Test_Available(void)
+{
+    return (uint16)(Test_RxLen - Test_RxPos);
+}
+
+static uint8 Test_ReadByte(void)
+{
+    return Test_Rx[Test_RxPos++];
+}
+
+/* The reply telegram over and over, for the timed run. */
+static uint16 Test_Repeating(void)
+{
+    return (uint16)1;
+}
+
+static uint8 Test_ReadRepeating(void)
+{
+    uint8 value = Test_Rx[Test_RxPos++];
+
+    if (Test_RxPos == Test_RxLen) {
+        Test_RxPos = (uint8)0;
+    }
+    return value;
+}
+
+static void Test_Callout(uint8 slave, Gb_ResultType result, uint8 const * frame, uint8 len)
+{
+    CHECK(slave == TEST_SLAVE);
+    CHECK(result == GB_RESULT_REPLY);
+    CHECK((frame != NULL) && (len == Test_RxLen));
+    ++Test_Replies;
+}
+
+static void Test_FrameReceived(uint8 * buffer, uint8 len)
+{
+    (void)buffer;
+    (void)len;
+    ++Test_Frames;
+}
+
+static void Test_Footprint(void)
+{
+    printf("static footprint: %u of %u bytes\n", (unsigned)Gb_StaticFootprint, (unsigned)GB_CFG_RAM_BUDGET);
+    CHECK(Gb_StaticFootprint <= (SizeType)GB_CFG_RAM_BUDGET);
+}
+
+static void Test_RoundTrip(void)
+{
+    static const uint8 request[] = { 0x02, 0x02, 0x25, 0x27 };      /* GET h, q */
+    static const uint8 reply[] = { 0x02, 0x02, 0x7a, 0x42 };
+    Gb_SlaveType const * slave;
+    uint32 now;
+
+    Gb_Init(&Test_Port, TEST_MASTER, Test_Callout);
+    CHECK(Gb_AddSlave(TEST_SLAVE) == GB_OK);
+    CHECK(Gb_Submit(TEST_SLAVE, request, (uint8)sizeof(request)) == GB_OK);
+    CHECK(Gb_Submit((uint8)0x21, request, (uint8)sizeof(request)) == GB_E_UNKNOWN_SLAVE);
+
+    Gb_Poll((uint32)0);
+    CHECK(Test_TxLen == (uint16)(sizeof(request) + 6));
+    CHECK((Test_Tx[0] == GB_SD_REQUEST) && (Test_Tx[2] == TEST_SLAVE) && (Test_Tx[3] == TEST_MASTER));
+
+    Test_RxLen = LinkLayer_BuildFrame(Test_Rx, GB_SD_REPLY, TEST_MASTER, TEST_SLAVE, reply, (uint8)sizeof(reply));
+    Test_RxPos = (uint8)0;
+    /* No more than GB_CFG_RX_BYTES_PER_POLL bytes per call. */
+    for (now = (uint32)1; (Test_Replies == 0U) && (now < (uint32)GB_CFG_REPLY_TIMEOUT); ++now) {
+        uint8 before = Test_RxPos;
+
+        Gb_Poll(now);
+        CHECK((uint8)(Test_RxPos - before) <= (uint8)GB_CFG_RX_BYTES_PER_POLL);
+    }
+    CHECK(Test_Replies == 1U);
+    CHECK(Gb_Idle());
+    slave = Gb_GetSlave(TEST_SLAVE);
+    CHECK((slave != NULL) && (slave->replies == (uint16)1) && (slave->pending == (uint8)0));
+}
+
+static void Test_ReceiveTiming(void)
+{
+    static const uint8 reply[] = { 0x02, 0x0c, 0x7a, 0x42, 0x39, 0x80, 0x04, 0x02, 0xb5, 0xc8, 0x03, 0x00, 0xf2, 0xd7 };
+    Interface port = { Test_WriteFrame, Test_Repeating, Test_ReadRepeating };
+    DatalinkLayerType link;
+    unsigned long bytes = 0UL;
+    unsigned long frames;
+    clock_t started;
+    double nsPerByte;
+    char const * limit;
+
+    Test_RxLen = LinkLayer_BuildFrame(Test_Rx, GB_SD_REPLY, TEST_MASTER, TEST_SLAVE, reply, (uint8)sizeof(reply));
+    Test_RxPos = (uint8)0;
+    Test_Frames = 0U;
+    link.port = &port;
+    link.dataLinkCallout = Test_FrameReceived;
+    link.errorCallout = NULL;
+    LinkLayer_Init(&link);
+
+    started = clock();
+    while (bytes < TEST_TIMED_BYTES) {
+        bytes += LinkLayer_Process(&link, (uint16)GB_CFG_RX_BYTES_PER_POLL);
+    }
+    nsPerByte = ((double)(clock() - started) / CLOCKS_PER_SEC) * 1e9 / (double)bytes;
+
+    frames = bytes / Test_RxLen;
+    CHECK((Test_Frames == frames) || (Test_Frames == frames + 1UL));
+    printf("receive path: %.1f ns/byte over %lu bytes (%u-byte frames, %u bytes per poll)\n",
+        nsPerByte, bytes, (unsigned)Test_RxLen, (unsigned)GB_CFG_RX_BYTES_PER_POLL);
+    limit = getenv("GB_TEST_MAX_NS_PER_BYTE");
+    if (limit != NULL) {
+        CHECK(nsPerByte <= atof(limit));
+    }
+}
+
+int main(void)
+{
+    Test_Footprint();
+    Test_RoundTrip();
+    Test_ReceiveTiming();
+    return (Test_Failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
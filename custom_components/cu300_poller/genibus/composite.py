@@ -0,0 +1,105 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+##
+## Values spread over several IDs (hi/lo bytes or words).
+##
+## The parts of a composite are always requested in the same APDU (see
+## apdu.createGetAPDUs), so the unit samples them together. Counters can
+## still tear when the low part wraps between the unit latching the high and
+## the low part; those are caught by the monotonicity check below.
+##
+
+from collections import namedtuple
+import logging
+
+logger = logging.getLogger("Genibus")
+
+Composite = namedtuple('Composite', 'parts monotonic note')
+
+COMPOSITES = {
+    'speed':    Composite(('speed_hi', 'speed_lo'), False, 'Motor speed'),
+    't_2hour':  Composite(('t_2hour_hi', 't_2hour_lo'), True, 'Two hour counter'),
+    'energy':   Composite(('energy_hi', 'energy_lo'), True, 'Accumulated electric energy consumption'),
+}
+
+# Resolved layout of a composite for a given model: names of the parts, bits per part.
+Layout = namedtuple('Layout', 'parts width monotonic')
+
+
+def combine(values, width):
+    result = 0
+    for value in values:
+        result = (result << width) | value
+    return result
+
+
+class CompositeDecoder(object):
+    """Assembles composite values and suppresses torn counter readings.
+
+    A monotonic counter may only grow, and by less than one wrap of its
+    lowest part per reading. A reading outside that window is held back; it
+    is accepted only if the next reading confirms it (e.g. after the gateway
+    was offline for a while), so a single torn read never reaches consumers.
+    """
+
+    def __init__(self):
+        self._last = {}
+        self._candidate = {}
+
+    def reset(self):
+        self._last.clear()
+        self._candidate.clear()
+
+    def decode(self, values, layouts):
+        """Add the composite values described in `layouts` (name -> Layout) to `values`."""
+        for name, layout in layouts.items():
+            parts = [values.get(part) for part in layout.parts]
+            if None in parts:
+                continue
+            value = combine(parts, layout.width)
+            if layout.monotonic and not self._consistent(name, value, 1 << layout.width):
+                continue
+            values[name] = value
+        return values
+
+    def _consistent(self, name, value, window):
+        last = self._last.get(name)
+        if last is None or last <= value < last + window:
+            self._last[name] = value
+            self._candidate.pop(name, None)
+            return True
+        candidate = self._candidate.get(name)
+        if candidate is not None and candidate <= value < candidate + window:
+            logger.info("Counter '{0}' confirmed at {1} (was {2})".format(name, value, last))
+            self._last[name] = value
+            self._candidate.pop(name, None)
+            return True
+        logger.warning("Discarding inconsistent reading of '{0}': {1} (last {2})".format(name, value, last))
+        self._candidate[name] = value
+        return False
@@ -0,0 +1,122 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+##
+## Incremental alarm history.
+##
+## The unit keeps its last five alarms in alarm_log_1 (newest) .. alarm_log_5,
+## next to the start/stop/survive alarm slots and their backups. Those rarely
+## change, so instead of polling them every cycle only a few cheap indicators
+## are watched; the log is fetched when one of them changes and diffed into an
+## append-only stream of alarm events.
+##
+
+from collections import deque, namedtuple
+import itertools
+
+from ..devices.db import DeviceDB
+
+INDICATORS = ('alarm_code', 'alarm_code_disp', 'led_contr')
+
+ALARM_LOG = ('alarm_log_1', 'alarm_log_2', 'alarm_log_3', 'alarm_log_4', 'alarm_log_5')
+
+ALARM_SLOTS = (
+    'start_alarm1', 'start_alarm2', 'qsd_alarm1', 'qsd_alarm2',
+    'stop_alarm1', 'stop_alarm2', 'stop_alarm3', 'surv_alarm1', 'surv_alarm2', 'ind_alarm',
+    'start_alarm1_bak', 'start_alarm2_bak', 'qsd_alarm1_bak', 'qsd_alarm2_bak',
+    'stop_alarm1_bak', 'stop_alarm2_bak', 'stop_alarm3_bak', 'surv_alarm1_bak', 'surv_alarm2_bak', 'ind_alarm_bak',
+)
+
+DEFAULT_CAPACITY = 1000
+
+# source: 'log' for a new entry of the alarm log, otherwise the name of the alarm slot.
+AlarmEvent = namedtuple('AlarmEvent', 'seq timestamp source code previous')
+
+
+def alarmDatapoints(model):
+    """Names of the alarm log and alarm slots the catalog of `model` knows."""
+    db = DeviceDB()
+    return [name for name in ALARM_LOG + ALARM_SLOTS if db.dataitemByClassAndName(model, name)]
+
+
+def newLogEntries(previous, current):
+    """Entries pushed into the alarm log between two readings, oldest first.
+
+    The log is a shift register (newest first), so the new entries are the
+    shortest prefix of `current` after which the rest lines up with `previous`.
+    """
+    size = len(current)
+    for shift in range(size + 1):
+        if tuple(current[shift:]) == tuple(previous[:size - shift]):
+            return list(reversed(current[:shift]))
+    return list(reversed(current))
+
+
+class AlarmHistory(object):
+
+    def __init__(self, capacity = DEFAULT_CAPACITY):
+        self.events = deque(maxlen = capacity)
+        self._seq = itertools.count(1)
+        self._indicators = None
+        self._log = None
+        self._slots = {}
+
+    def changed(self, values):
+        """True if the indicators in `values` differ from those of the last fetched log."""
+        return self._indicators is None or tuple(values.get(name) for name in INDICATORS) != self._indicators
+
+    def update(self, timestamp, indicators, values):
+        """Diff a freshly fetched log (and alarm slots) into events; returns the new events.
+
+        The first fetch only sets the baseline, so a restart doesn't replay old alarms.
+        """
+        events = []
+        log = tuple(values.get(name, 0) for name in ALARM_LOG)
+        if self._log is not None:
+            for code in newLogEntries(self._log, log):
+                if code:
+                    events.append(self._event(timestamp, 'log', code, None))
+        for name in ALARM_SLOTS:
+            if name not in values:
+                continue
+            previous = self._slots.get(name)
+            if previous is not None and values[name] != previous:
+                events.append(self._event(timestamp, name, values[name], previous))
+            self._slots[name] = values[name]
+        self._log = log
+        self._indicators = tuple(indicators.get(name) for name in INDICATORS)
+        self.events.extend(events)
+        return events
+
+    def since(self, seq):
+        """Events with a sequence number above `seq`, as far as still buffered."""
+        return [event for event in self.events if event.seq > seq]
+
+    def _event(self, timestamp, source, code, previous):
+        return AlarmEvent(next(self._seq), timestamp, source, code, previous)
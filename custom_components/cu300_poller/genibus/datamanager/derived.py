@@ -0,0 +1,201 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+##
+## Derived metrics, updated incrementally from every poll.
+##
+## A metric is an expression over datapoints (or over metrics defined before
+## it). Instantaneous metrics are a plain function of the current sample;
+## windowed ones keep a running trapezoidal integral or counter delta over the
+## last `window` seconds, so each new sample costs O(1) (amortized) no matter
+## how long the history is.
+##
+## Inputs are expected in the units the formulas use: flow in m³/h, head in m,
+## power in W, the two hour counter in counts of 2 h and energy in kWh. Pass
+## `scales` to the engine to convert raw datapoint values first. Flow, head
+## and power are scaled bytes on the bus; with `requireScales`, metrics that
+## depend on one of them are not computed until its scale is known (see
+## `setScale()`, fed from the unit's INFO replies).
+##
+
+from collections import deque
+
+RHO = 998.0     # kg/m³, water at ~20 °C
+G   = 9.81      # m/s²
+
+# Inputs that need a scale, with the factors from the units a unit may report to the formula's unit.
+SCALED_INPUTS = {
+    'flow':     {'m³/h': 1.0, 'm3/h': 1.0, 'm³/s': 3600.0, 'l/s': 3.6, 'l/min': 0.06, 'l/h': 0.001, 'gpm': 0.2271247},
+    'head':     {'m': 1.0, 'ft': 0.3048},
+    'power':    {'W': 1.0, 'kW': 1000.0},
+}
+
+
+class Metric(object):
+
+    def __init__(self, name, inputs, unit = None):
+        self.name = name
+        self.inputs = tuple(inputs)
+        self.unit = unit
+
+    def update(self, timestamp, values):
+        raise NotImplementedError()
+
+
+class Expression(Metric):
+    """fn(*inputs) of the current sample."""
+
+    def __init__(self, name, inputs, function, unit = None):
+        super(Expression, self).__init__(name, inputs, unit)
+        self._function = function
+
+    def update(self, timestamp, values):
+        args = [values.get(name) for name in self.inputs]
+        if None in args:
+            return None
+        try:
+            return self._function(*args)
+        except ZeroDivisionError:
+            return None
+
+
+class WindowedIntegral(Metric):
+    """Trapezoidal integral of an input (per hour) over the last `window` seconds."""
+
+    def __init__(self, name, input, window, unit = None):
+        super(WindowedIntegral, self).__init__(name, (input, ), unit)
+        self.window = window
+        self._slices = deque()
+        self._sum = 0.0
+        self._last = None
+
+    def update(self, timestamp, values):
+        value = values.get(self.inputs[0])
+        if value is None:
+            return None
+        if self._last is not None:
+            lastTime, lastValue = self._last
+            area = (timestamp - lastTime) * (value + lastValue) / 2.0 / 3600.0
+            self._slices.append((timestamp, area))
+            self._sum += area
+        self._last = (timestamp, value)
+        while self._slices and self._slices[0][0] <= timestamp - self.window:
+            self._sum -= self._slices.popleft()[1]
+        return self._sum
+
+
+class WindowedDelta(Metric):
+    """Increase of a counter over the last `window` seconds, times `factor`."""
+
+    def __init__(self, name, input, window, factor = 1.0, unit = None):
+        super(WindowedDelta, self).__init__(name, (input, ), unit)
+        self.window = window
+        self._factor = factor
+        self._samples = deque()
+
+    def update(self, timestamp, values):
+        value = values.get(self.inputs[0])
+        if value is None:
+            return None
+        self._samples.append((timestamp, value))
+        while len(self._samples) > 1 and self._samples[1][0] <= timestamp - self.window:
+            self._samples.popleft()
+        return (value - self._samples[0][1]) * self._factor
+
+
+def defaultMetrics(window = 3600.0):
+    return [
+        Expression('hydraulic_power', ('flow', 'head'), lambda q, h: RHO * G * (q / 3600.0) * h, 'W'),
+        Expression('efficiency', ('hydraulic_power', 'power'), lambda ph, p: 100.0 * ph / p, '%'),
+        WindowedIntegral('energy_window', 'power', window, 'Wh'),
+        WindowedIntegral('volume_window', 'flow', window, 'm³'),
+        Expression('specific_energy', ('energy_window', 'volume_window'), lambda e, v: e / 1000.0 / v, 'kWh/m³'),
+        WindowedDelta('run_time_window', 't_2hour', window, 2.0, 'h'),
+        WindowedDelta('energy_counter_window', 'energy', window, 1.0, 'kWh'),
+    ]
+
+
+class DerivedEngine(object):
+    """Evaluates a list of metrics, in order, for every new sample."""
+
+    def __init__(self, metrics = None, scales = None, requireScales = False):
+        self.metrics = defaultMetrics() if metrics is None else metrics
+        # name -> factor, or (factor, offset).
+        self._scales = {}
+        for name, scale in (scales or {}).items():
+            self._scales[name] = tuple(scale) if isinstance(scale, (tuple, list)) else (scale, 0.0)
+        self._requireScales = requireScales
+
+    @property
+    def inputs(self):
+        """Datapoints the metrics need that are not produced by another metric."""
+        produced = set(metric.name for metric in self.metrics)
+        return set(name for metric in self.metrics for name in metric.inputs) - produced
+
+    def requires(self, name):
+        """Datapoints metric `name` depends on, directly or through other metrics."""
+        metrics = dict((metric.name, metric) for metric in self.metrics)
+        result, pending = set(), [name]
+        while pending:
+            metric = metrics.get(pending.pop())
+            for input in metric.inputs if metric else ():
+                if input in metrics:
+                    pending.append(input)
+                else:
+                    result.add(input)
+        return result
+
+    def setScale(self, name, factor, offset, unit):
+        """Scale of input `name` as reported by the unit; False if `unit` can't be converted to the formula's."""
+        conversion = SCALED_INPUTS.get(name, {}).get(unit.strip())
+        if conversion is None:
+            self._scales.pop(name, None)
+            return False
+        self._scales[name] = (factor * conversion, offset * conversion)
+        return True
+
+    def clearScales(self):
+        self._scales.clear()
+
+    def update(self, timestamp, sample):
+        """Feed one sample (name -> raw value); returns the derived values (name -> value or None)."""
+        values = {}
+        for name, value in sample.items():
+            if not isinstance(value, (int, float)):
+                continue
+            scale = self._scales.get(name)
+            if scale is not None:
+                values[name] = value * scale[0] + scale[1]
+            elif not (self._requireScales and name in SCALED_INPUTS):
+                values[name] = value
+        result = {}
+        for metric in self.metrics:
+            value = metric.update(timestamp, values)
+            values[metric.name] = result[metric.name] = value
+        return result
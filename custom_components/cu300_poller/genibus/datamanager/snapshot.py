@@ -0,0 +1,194 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+
+##
+## Persisted last-known values for a warm start.
+##
+## The values of every poll are written through a memory-mapped file, so a
+## write is a copy into the page cache (the kernel flushes it) instead of a
+## serialise-rename-fsync cycle per poll. On the next start the values are
+## read back and shown, marked stale, before the unit has even answered.
+##
+## The file holds two slots that are written alternately; each slot carries
+## a generation counter and a CRC of its payload, so a write torn by a crash
+## or power loss leaves the previous slot as the newest valid one.
+##
+## Layout: header (magic, version, slot capacity), then two slots of
+## (generation, wall time, length, crc32) + `capacity` bytes of JSON.
+##
+## Opening, mapping and resizing the file is file-system work; callers on an
+## event loop do it with `open()` in an executor and only `write()` (a copy
+## into the mapping) from the loop. `save()` does both, for everyone else.
+##
+
+import json
+import mmap
+import os
+import struct
+import time
+import zlib
+
+SNAPSHOT_MAGIC = b"GBSN"
+SNAPSHOT_VERSION = 1
+
+INITIAL_CAPACITY = 4096
+
+_HEADER = struct.Struct("<4sHHI")       # magic, version, reserved, capacity
+_SLOT = struct.Struct("<QdII")          # generation, time, length, crc32
+
+
+def _jsonable(value):
+    return value is None or isinstance(value, (bool, int, float, str))
+
+
+class Snapshot(object):
+    """Last-known values of one unit: `load()` once at start, `save()` every poll."""
+
+    def __init__(self, path):
+        self.path = path
+        self._fd = None
+        self._map = None
+        self._capacity = 0
+        self._generation = 0
+
+    def load(self):
+        """(values, meta, wall time) of the newest valid slot, or None if there is none."""
+        try:
+            with open(self.path, "rb") as fp:
+                data = fp.read()
+        except OSError:
+            return None
+        best = None
+        for generation, stamp, payload in self._slots(data):
+            if best is None or generation > best[0]:
+                best = (generation, stamp, payload)
+        if best is None:
+            return None
+        self._generation = best[0]
+        try:
+            content = json.loads(best[2])
+        except ValueError:
+            return None
+        return content.get("values", {}), content.get("meta", {}), best[1]
+
+    def save(self, values, meta = None):
+        """Write `values` (non-JSON values are skipped) and `meta` into the older slot."""
+        payload = self.encode(values, meta)
+        if not self.fits(payload):
+            self.open(len(payload))
+        return self.write(payload)
+
+    @staticmethod
+    def encode(values, meta = None):
+        return json.dumps({
+            "values": {name: value for name, value in values.items() if _jsonable(value)},
+            "meta": meta or {},
+        }, separators = (",", ":")).encode("utf-8")
+
+    def fits(self, payload):
+        """Whether `payload` can be written without (re)mapping the file."""
+        return self._map is not None and len(payload) <= self._capacity
+
+    def open(self, needed = 0):
+        """Map the file, with slots of at least `needed` bytes."""
+        self._open(needed)
+
+    def write(self, payload):
+        """Copy an encoded `payload` into the older slot; the mapping must fit it (see fits())."""
+        if not self.fits(payload):
+            raise ValueError("Snapshot not mapped or too small for {0} bytes".format(len(payload)))
+        self._generation += 1
+        offset = _HEADER.size + (self._generation & 1) * (_SLOT.size + self._capacity)
+        start = offset + _SLOT.size
+        # Payload first, then its header: a torn write never validates.
+        self._map[start : start + len(payload)] = payload
+        _SLOT.pack_into(self._map, offset, self._generation, time.time(), len(payload), zlib.crc32(payload))
+        return self._generation
+
+    def close(self):
+        if self._map is not None:
+            self._map.close()
+            self._map = None
+        if self._fd is not None:
+            os.close(self._fd)
+            self._fd = None
+
+    def _open(self, needed):
+        """Map the file, (re)sized so a slot holds `needed` bytes; a valid file keeps its slots."""
+        capacity = max(INITIAL_CAPACITY, self._capacity)
+        while capacity < needed:
+            capacity *= 2
+        if self._fd is None:
+            self._fd = os.open(self.path, os.O_RDWR | os.O_CREAT, 0o644)
+            current = self._read_capacity()
+            if current is not None:
+                # Carry on counting from the slots already there.
+                size = _HEADER.size + 2 * (_SLOT.size + current)
+                for generation, _, _ in self._slots(os.pread(self._fd, size, 0)):
+                    self._generation = max(self._generation, generation)
+                capacity = max(capacity, current)
+        if self._map is not None:
+            self._map.close()
+            self._map = None
+        if capacity != self._capacity:
+            if capacity != self._read_capacity():
+                # Slot offsets move; start over with an empty file of the new size.
+                os.ftruncate(self._fd, 0)
+            os.ftruncate(self._fd, _HEADER.size + 2 * (_SLOT.size + capacity))
+        self._map = mmap.mmap(self._fd, 0)
+        _HEADER.pack_into(self._map, 0, SNAPSHOT_MAGIC, SNAPSHOT_VERSION, 0, capacity)
+        self._capacity = capacity
+
+    def _read_capacity(self):
+        header = os.pread(self._fd, _HEADER.size, 0)
+        if len(header) < _HEADER.size:
+            return None
+        magic, version, _, capacity = _HEADER.unpack(header)
+        if magic != SNAPSHOT_MAGIC or version != SNAPSHOT_VERSION:
+            return None
+        if os.fstat(self._fd).st_size != _HEADER.size + 2 * (_SLOT.size + capacity):
+            return None
+        return capacity
+
+    @staticmethod
+    def _slots(data):
+        if len(data) < _HEADER.size:
+            return
+        magic, version, _, capacity = _HEADER.unpack_from(data, 0)
+        if magic != SNAPSHOT_MAGIC or version != SNAPSHOT_VERSION:
+            return
+        for index in range(2):
+            offset = _HEADER.size + index * (_SLOT.size + capacity)
+            if len(data) < offset + _SLOT.size:
+                return
+            generation, stamp, length, crc = _SLOT.unpack_from(data, offset)
+            payload = data[offset + _SLOT.size : offset + _SLOT.size + length]
+            if generation and length <= capacity and len(payload) == length and zlib.crc32(payload) == crc:
+                yield generation, stamp, payload
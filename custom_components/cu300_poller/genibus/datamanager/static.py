@@ -0,0 +1,85 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+##
+## Static data tier.
+##
+## Class 4 configuration parameters and class 7 strings practically never
+## change. They are kept out of the poll plan; this cache holds their values
+## (persisted by the caller between runs) and tracks which of them have been
+## validated against the unit since the last (re)connect or own SET.
+##
+
+from .. import gbdefs as defs
+from ..devices.db import DeviceDB
+
+STATIC_CLASSES = (
+    defs.APDUClass.CONFIGURATION_PARAMETERS,
+    defs.APDUClass.ASCII_STRINGS,
+)
+
+
+def isStatic(model, name):
+    item = DeviceDB().dataitemByClassAndName(model, name)
+    return bool(item) and item[1] in STATIC_CLASSES
+
+
+class StaticCache(object):
+
+    def __init__(self):
+        self.values = {}
+        self._validated = set()
+
+    def missing(self, names):
+        """Names that need a (re-)read from the unit."""
+        return sorted(set(names) - self._validated)
+
+    def store(self, names, values):
+        """Record the values read for `names`; names the unit didn't answer are dropped."""
+        for name in names:
+            if name in values:
+                self.values[name] = values[name]
+            else:
+                self.values.pop(name, None)
+            self._validated.add(name)
+
+    def invalidate(self, names = None):
+        """Re-validate `names` (all if None) on the next poll; values stay available meanwhile."""
+        if names is None:
+            self._validated.clear()
+        else:
+            self._validated.difference_update(names)
+
+    def dump(self):
+        return dict(self.values)
+
+    def load(self, values):
+        """Restore persisted values; they count as unvalidated."""
+        self.values = dict(values or {})
+        self._validated.clear()
@@ -0,0 +1,176 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+##
+## Streaming statistics for condition monitoring.
+##
+## Every (slave, metric) pair is one stream. The state of all streams lives
+## in flat array('d') columns (struct of arrays, metric-major: stream index =
+## metric * slaves + slave), so a sweep is one pass over contiguous doubles
+## instead of a walk over per-pump objects. Polls are staged with `load()`;
+## `sweep()` then updates EWMA mean and variance, min/max and z-score of all
+## streams with a fresh sample and, in the same pass, reports streams that
+## crossed a threshold.
+##
+## The z-score of a sample is taken against the statistics *before* it, so a
+## step change shows up at full strength in the sweep it happens.
+##
+
+from array import array
+from collections import namedtuple
+import math
+
+# Keyed like the published poll data, i.e. with DATA_KEYS of protocol.py
+# applied: p, h and q arrive as power, head and flow.
+DEFAULT_METRICS = ('power', 'i_mo', 't_m', 'v_dc', 'speed', 'head', 'flow')
+DEFAULT_ALPHA = 0.05
+DEFAULT_Z_LIMIT = 4.0
+WARMUP = 20
+
+NORMAL  = 0
+HIGH    = 1
+LOW     = -1
+
+NAN = float('nan')
+
+# kind: 'z' for a z-score excursion, 'limit' for a fixed limit; state: HIGH, LOW or NORMAL (cleared).
+ThresholdEvent = namedtuple('ThresholdEvent', 'slave metric kind state value zscore')
+
+Stats = namedtuple('Stats', 'count mean variance minimum maximum zscore')
+
+
+class StatsEngine(object):
+
+    def __init__(self, slaves, metrics = DEFAULT_METRICS, alpha = DEFAULT_ALPHA, zLimit = DEFAULT_Z_LIMIT, limits = None, warmup = WARMUP):
+        self.slaves = list(slaves)
+        self.metrics = tuple(metrics)
+        self.alpha = alpha
+        self.zLimit = zLimit
+        self.warmup = warmup
+        self._slaveIndex = dict((slave, idx) for idx, slave in enumerate(self.slaves))
+        size = len(self.slaves) * len(self.metrics)
+        self.size = size
+        self.sample = array('d', [NAN]) * size
+        self.count = array('d', [0.0]) * size
+        self.mean = array('d', [0.0]) * size
+        self.variance = array('d', [0.0]) * size
+        self.minimum = array('d', [math.inf]) * size
+        self.maximum = array('d', [-math.inf]) * size
+        self.zscore = array('d', [0.0]) * size
+        self._zState = array('b', [NORMAL]) * size
+        self._limitState = array('b', [NORMAL]) * size
+        # limits: metric -> (low, high); either may be None.
+        limits = limits or {}
+        self._low = array('d', [-math.inf]) * size
+        self._high = array('d', [math.inf]) * size
+        for m, metric in enumerate(self.metrics):
+            low, high = limits.get(metric, (None, None))
+            for s in range(len(self.slaves)):
+                if low is not None:
+                    self._low[m * len(self.slaves) + s] = low
+                if high is not None:
+                    self._high[m * len(self.slaves) + s] = high
+
+    def index(self, slave, metric):
+        return self.metrics.index(metric) * len(self.slaves) + self._slaveIndex[slave]
+
+    def load(self, slave, values):
+        """Stage the decoded values of one slave's poll for the next sweep."""
+        s = self._slaveIndex[slave]
+        stride = len(self.slaves)
+        sample = self.sample
+        for m, metric in enumerate(self.metrics):
+            value = values.get(metric)
+            if isinstance(value, (int, float)):
+                sample[m * stride + s] = value
+
+    def sweep(self):
+        """Fold the staged samples into the statistics; returns the threshold events."""
+        alpha = self.alpha
+        keep = 1.0 - alpha
+        zLimit = self.zLimit
+        warmup = self.warmup
+        sample, count, mean, variance = self.sample, self.count, self.mean, self.variance
+        minimum, maximum, zscore = self.minimum, self.maximum, self.zscore
+        low, high = self._low, self._high
+        zState, limitState = self._zState, self._limitState
+        events = []
+        for idx in range(self.size):
+            x = sample[idx]
+            if x != x:
+                continue
+            sample[idx] = NAN
+            n = count[idx]
+            if n == 0.0:
+                # First sample: seeds the statistics, but the fixed limits apply already.
+                z = 0.0
+                count[idx] = 1.0
+                mean[idx] = minimum[idx] = maximum[idx] = x
+            else:
+                mu = mean[idx]
+                var = variance[idx]
+                diff = x - mu
+                z = diff / math.sqrt(var) if var > 0.0 else 0.0
+                zscore[idx] = z
+                mean[idx] = mu + alpha * diff
+                variance[idx] = keep * (var + alpha * diff * diff)
+                count[idx] = n + 1.0
+                if x < minimum[idx]:
+                    minimum[idx] = x
+                if x > maximum[idx]:
+                    maximum[idx] = x
+            state = HIGH if x > high[idx] else LOW if x < low[idx] else NORMAL
+            if state != limitState[idx]:
+                limitState[idx] = state
+                events.append(self._event(idx, 'limit', state, x, z))
+            if n and n >= warmup:
+                state = HIGH if z > zLimit else LOW if z < -zLimit else NORMAL
+                if state != zState[idx]:
+                    zState[idx] = state
+                    events.append(self._event(idx, 'z', state, x, z))
+        return events
+
+    def stats(self, slave, metric):
+        idx = self.index(slave, metric)
+        if not self.count[idx]:
+            return None
+        return Stats(int(self.count[idx]), self.mean[idx], self.variance[idx], self.minimum[idx], self.maximum[idx], self.zscore[idx])
+
+    def snapshot(self, slave):
+        """metric -> Stats of one slave, for the metrics seen so far."""
+        result = {}
+        for metric in self.metrics:
+            stats = self.stats(slave, metric)
+            if stats is not None:
+                result[metric] = stats
+        return result
+
+    def _event(self, idx, kind, state, value, zscore):
+        m, s = divmod(idx, len(self.slaves))
+        return ThresholdEvent(self.slaves[s], self.metrics[m], kind, state, value, zscore)
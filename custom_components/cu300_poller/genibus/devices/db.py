@@ -26,104 +26,172 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 """
 
+##
+## Device catalog.
+##
+## The JSON files next to this module (one per model), config/units.json and
+## the identity map config/models.json are compiled into an immutable
+## `Catalog`. `DeviceDB` publishes one catalog version at a time,
+## read-copy-update style:
+##
+##  - readers fetch the current version with a single attribute load and never
+##    take a lock; a lookup that started on the old version finishes on it;
+##  - `reload()` compiles the new version off to the side (validation errors
+##    leave the current one in place) and swaps it in with one assignment;
+##  - the old version lives on as long as anything still references it, e.g.
+##    a request plan compiled from it; that is the grace period, after which
+##    it is simply garbage collected. `version` tells plan owners to recompile.
+##
+
 from collections import namedtuple
 import glob
 import json
 import os
-from pprint import pprint
-import sqlite3
+import weakref
 from ..utils.classes import SingletonBase
 
 DataitemByClass = namedtuple('DataitemByClass', 'name, id, access, note')
 DataitemByClassAndName = namedtuple('DataitemByClassAndName', 'id, klass, access, note')
 
-class DeviceDB(SingletonBase):
-
-    def __init__(self):
-        self.open()
-        self.importFiles()
-
-    def createSchema(self):
-        #print("Creating schema...")
-        self.cursor.execute("""
-            CREATE TABLE dataitems(
-                model CHAR(64) NOT NULL, name CHAR(64) NOT NULL,
-                class INT NOT NULL, id INT NOT NULL, access INT NOT NULL, note CHAR(64) DEFAULT NULL,
-                PRIMARY KEY(model, name)
-            );
-        """)
-
-        self.cursor.execute("""CREATE TABLE units(
-            id INT NOT NULL PRIMARY KEY, physicalEntity CHAR(64), prefix DOUBLE, Unit CHAR(8)
-            );
-        """)
-        self.conn.commit()
-
-    def open(self):
-        self.conn = sqlite3.connect(":memory:")
-        self.cursor = self.conn.cursor()
-        self.createSchema()
-
-    def toList(self, *args):
-        result = []
-        for elem in args:
-            if isinstance(elem, (list, tuple)):
-                result.extend(list(elem))
-            else:
-                result.append(elem)
-        return result
-
-    def importFiles(self):
-        _dir = os.path.dirname(__file__)  # Use current file's directory
-        for dp in glob.glob(f"{_dir}{os.sep}*.json"):
+CATALOG_DIR = os.path.dirname(__file__)
+UNITS_FILE = os.path.join(os.path.dirname(__file__), '..', 'config', 'units.json')
+# Maps the unit_family / unit_type codes of a connect reply to a model; '*' matches any type.
+MODELS_FILE = os.path.join(os.path.dirname(__file__), '..', 'config', 'models.json')
+
+DEFAULT_MODEL = 'magna'
+
+
+class Catalog(object):
+    """One compiled, read-only version of the device catalog."""
+
+    def __init__(self, dataitems, units, models = None):
+        self.version = None
+        self._dataitems = sorted(dataitems, key = lambda row: (row[0], row[2], row[3]))
+        self._byModel = {}
+        self._byClass = {}
+        self._byName = {}
+        for row in self._dataitems:
+            model, name, klass, id, access, note = row
+            if (model, name) in self._byName:
+                raise ValueError("Duplicate datapoint '{}' in model '{}'".format(name, model))
+            self._byModel.setdefault(model, []).append(row)
+            self._byClass.setdefault((model, klass), {})[name] = DataitemByClass(name, id, access, note)
+            self._byName[(model, name)] = DataitemByClassAndName(id, klass, access, note)
+        self._units = sorted(units)
+        models = models or {}
+        self.defaultModel = models.get('default', DEFAULT_MODEL)
+        self._families = {}
+        for family, types in models.get('families', {}).items():
+            self._families[int(family)] = dict((key if key == '*' else int(key), model) for key, model in types.items())
+        for model in [self.defaultModel] + [model for types in self._families.values() for model in types.values()]:
+            if model not in self._byModel:
+                raise ValueError("Model '{}' of the identity map is not in the catalog".format(model))
+
+    @classmethod
+    def fromFiles(cls, directory = CATALOG_DIR, unitsFile = UNITS_FILE, modelsFile = MODELS_FILE):
+        dataitems = []
+        for dp in sorted(glob.glob(f"{directory}{os.sep}*.json")):
             _, fullname = os.path.split(dp)
             model = fullname.split('.')[0]
             with open(dp) as filePointer:
                 data = json.load(filePointer)
             for row in data:
-                self.conn.execute("INSERT INTO dataitems VALUES(?, ?, ?, ?, ?, ?)", self.toList(model, row))
-        self.conn.commit()
-        # Load units.json from genibus/config/
-        with open(os.path.join(os.path.dirname(__file__), '..', 'config', 'units.json')) as f:
+                name, klass, id, access, note = row
+                dataitems.append((model, name, int(klass), int(id), int(access), note))
+        with open(unitsFile) as f:
             units = json.load(f)
-        for key, unit in units.items():
-            unit[0] = unit[0].strip()
-            self.conn.execute("INSERT INTO units VALUES(?, ?, ?, ?)", self.toList(key, unit))
-        self.conn.commit()
+        units = [(int(key), entity.strip(), float(prefix), unit) for key, (entity, prefix, unit) in units.items()]
+        with open(modelsFile) as f:
+            models = json.load(f)
+        return cls(dataitems, units, models)
+
+    @property
+    def models(self):
+        return sorted(self._byModel)
+
+    def resolveModel(self, family, unitType):
+        """Model for the identity codes of a connect reply; the default model for unknown units."""
+        types = self._families.get(family, {})
+        return types.get(unitType) or types.get('*') or self.defaultModel
+
+    def dataitems(self, model):
+        return list(self._byModel.get(model, []))
+
+    def dataitemsByClass(self, model, klass):
+        return dict(self._byClass.get((model, klass), {})) or []
+
+    def dataitemByClassAndName(self, model, name):
+        return self._byName.get((model, name)) or []
+
+    def units(self):
+        return list(self._units)
+
+    def unitEnities(self):
+        return sorted(set((unit[1], ) for unit in self._units))
+
+    def unitsByEntity(self, entity):
+        return [unit for unit in self._units if unit[1] == entity]
+
+
+class DeviceDB(SingletonBase):
+
+    def __init__(self):
+        # SingletonBase runs __init__ on every DeviceDB() call; compile only once.
+        if getattr(self, '_catalog', None) is None:
+            self._version = 0
+            self._retired = weakref.WeakSet()
+            self.publish(self.loadCatalog())
+
+    @property
+    def catalog(self):
+        """The current version; hold on to it to see one consistent catalog across several lookups."""
+        return self._catalog
+
+    @property
+    def version(self):
+        return self._catalog.version
+
+    def loadCatalog(self, directory = CATALOG_DIR, unitsFile = UNITS_FILE, modelsFile = MODELS_FILE):
+        """Compile a catalog version without publishing it; safe to call from any thread."""
+        return Catalog.fromFiles(directory, unitsFile, modelsFile)
+
+    def publish(self, catalog):
+        """Make `catalog` the current version; returns its version number."""
+        previous = getattr(self, '_catalog', None)
+        self._version += 1
+        catalog.version = self._version
+        self._catalog = catalog
+        if previous is not None:
+            self._retired.add(previous)
+        return catalog.version
+
+    def reload(self, directory = CATALOG_DIR, unitsFile = UNITS_FILE, modelsFile = MODELS_FILE):
+        return self.publish(self.loadCatalog(directory, unitsFile, modelsFile))
+
+    def retired(self):
+        """Versions replaced by a newer one but still referenced (in their grace period)."""
+        return sorted(catalog.version for catalog in self._retired)
 
     def close(self):
-        self.conn.commit()
-        self.cursor.close()
-        self.conn.close()
+        pass
+
+    def resolveModel(self, family, unitType):
+        return self._catalog.resolveModel(family, unitType)
 
     def dataitems(self, model):
-        self.cursor.execute("SELECT * FROM dataitems WHERE model = ? ORDER BY class, id;", (model, ))
-        result = self.cursor.fetchall()
-        return result
+        return self._catalog.dataitems(model)
 
     def dataitemsByClass(self, model, klass):
-        self.cursor.execute("SELECT name, id, access, note FROM dataitems WHERE model = ? AND class = ? ORDER BY id;", (model, klass))
-        result = self.cursor.fetchall()
-        if result:
-            return {d.name: d for d in [DataitemByClass(*x) for x in result]}
-        return result
+        return self._catalog.dataitemsByClass(model, klass)
 
     def dataitemByClassAndName(self, model, name):
-        self.cursor.execute("SELECT id, class, access, note FROM dataitems WHERE model = ? AND name = ?;", (model, name))
-        result = self.cursor.fetchall()
-        return DataitemByClassAndName(*result[0]) if result else []
+        return self._catalog.dataitemByClassAndName(model, name)
 
     def units(self):
-        self.cursor.execute("SELECT * FROM units ORDER BY id;")
-        result = self.cursor.fetchall()
-        return result
+        return self._catalog.units()
 
     def unitEnities(self):
-        self.cursor.execute("SELECT DISTINCT(physicalEntity) FROM units ORDER BY 1;")
-        result = self.cursor.fetchall()
-        return result
+        return self._catalog.unitEnities()
 
     def unitsByEntity(self, entity):
-        self.cursor.execute("SELECT * FROM units WHERE physicalEntity = ? ORDER BY id;", (entity, ))
-        result = self.cursor.fetchall()
-        return result
\ No newline at end of file
+        return self._catalog.unitsByEntity(entity)
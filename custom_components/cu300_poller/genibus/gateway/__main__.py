@@ -0,0 +1,55 @@
+"""Run the sharded gateway: python -m <package>.genibus.gateway gateway.json
+
+    {
+        "socket": "/run/cu300/gateway.sock",
+        "workers": 4,
+        "clients": {"scada": {"weight": 4}, "reports": {"weight": 1, "budget": 0.2}},
+        "stream": {"socket": "/run/cu300/stream.sock", "host": "127.0.0.1", "port": 7010},
+        "ports": [
+            {"id": "well1", "connection_type": "serial", "port": "/dev/ttyUSB0", "datapoints": ["energy"]},
+            {"id": "well2", "connection_type": "tcp", "host": "10.0.0.7", "port": "4001", "interval": 10}
+        ]
+    }
+"""
+import argparse
+import asyncio
+import json
+import logging
+import signal
+
+from .aggregator import Aggregator
+from .worker import PortConfig
+
+
+def load_config(path: str) -> dict:
+    with open(path, encoding="utf-8") as fp:
+        config = json.load(fp)
+    config["ports"] = [
+        PortConfig(**dict(port, datapoints=tuple(port.get("datapoints", ())))) for port in config["ports"]
+    ]
+    return config
+
+
+async def serve(config: dict) -> None:
+    aggregator = Aggregator(config["ports"], config["socket"], config.get("workers"), config.get("clients"), config.get("stream"))
+    stopped = asyncio.Event()
+    loop = asyncio.get_running_loop()
+    for signum in (signal.SIGINT, signal.SIGTERM):
+        loop.add_signal_handler(signum, stopped.set)
+    await aggregator.start()
+    try:
+        await stopped.wait()
+    finally:
+        await aggregator.stop()
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description="Sharded CU300/GENIBus gateway")
+    parser.add_argument("config", help="JSON configuration file")
+    args = parser.parse_args()
+    logging.basicConfig(level=logging.INFO)
+    asyncio.run(serve(load_config(args.config)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,344 @@
+"""Front aggregator of the sharded gateway.
+
+Ports are split across worker processes (one per core by default); each
+worker polls its ports and publishes into shared-memory value tables owned
+by the aggregator. The aggregator serves one API for all of them on a Unix
+socket, as JSON lines:
+
+    {"op": "query"}                                  -> {"ok": true, "ports": {id: {"seq", "values", "error"}}}
+    {"op": "query", "port": "p1"}                    -> {"ok": true, "ports": {"p1": {...}}}
+    {"op": "subscribe", "ports": ["p1"]}             -> {"ok": true}, then
+                                                        {"event": "update", "port", "seq", "values": {changed}}
+    {"op": "command", "port": "p1", "command": "set_reference", "args": [50]}
+                                                     -> {"ok": true, "result": {readback}}
+    {"op": "read", "port": "p1", "datapoints": ["h", "q"]}
+                                                     -> {"ok": true, "result": {values}}
+
+Requests may name their "client"; bus time of commands and reads is shared
+between clients by weighted fair queuing, with the weights and budgets of
+the `clients` configuration (anonymous connections each count as their own
+client of weight 1).
+
+Subscribers also receive {"event": "threshold", "port", "metric", "kind",
+"state", "value", "zscore"} when a streaming statistic of a port crosses a
+threshold; the statistics of all ports are swept together once per watch
+interval.
+
+A subscriber that does not read fast enough misses events. Once it catches up,
+it gets the full values of every port it missed updates of, marked
+"resync": true.
+
+With a `stream` configuration ({"socket": path, "host": ..., "port": ...}),
+decoded values are also streamed to subscribers as binary delta batches;
+see stream.py.
+
+A worker that dies is restarted with exponential backoff; the other
+workers, and the last values of its ports, are not affected.
+"""
+import asyncio
+import itertools
+import json
+import logging
+import multiprocessing
+import os
+import time
+from dataclasses import dataclass, field
+
+from ..datamanager.stats import StatsEngine
+from .stream import StreamServer, MAX_BUFFER
+from .table import ValueTable
+from .worker import PortConfig, run_worker
+
+_LOGGER = logging.getLogger(__name__)
+
+COMMAND_TIMEOUT = 30
+WATCH_INTERVAL = 1.0
+MAX_RESTART_DELAY = 60.0
+
+
+def shard(ports: list[PortConfig], workers: int) -> list[list[PortConfig]]:
+    """Distribute ports round-robin over at most `workers` shards."""
+    shards = [[] for _ in range(max(1, min(workers, len(ports))))]
+    for idx, port in enumerate(ports):
+        shards[idx % len(shards)].append(port)
+    return shards
+
+
+@dataclass(eq=False)
+class _WorkerHandle:
+    index: int
+    ports: list[PortConfig]
+    process: multiprocessing.Process | None = None
+    conn: object = None
+    pending: dict = field(default_factory=dict)
+    restarts: int = 0
+    restart_at: float = 0.0
+
+
+@dataclass(eq=False)
+class _Subscriber:
+    writer: asyncio.StreamWriter
+    ports: set[str] | None
+    # Ports whose updates were dropped while the subscriber lagged behind.
+    missed: set[str] = field(default_factory=set)
+
+
+class Aggregator:
+
+    def __init__(
+        self,
+        ports: list[PortConfig],
+        socket_path: str,
+        workers: int | None = None,
+        clients: dict[str, dict] | None = None,
+        stream: dict | None = None,
+    ) -> None:
+        self._ports = {port.id: port for port in ports}
+        self._client_shares = clients or {}
+        self._stream_config = stream
+        self.stream = StreamServer({port.id: port.names for port in ports})
+        self._socket_path = socket_path
+        self._handles = [
+            _WorkerHandle(index, shard_ports)
+            for index, shard_ports in enumerate(shard(ports, workers or os.cpu_count() or 1))
+        ]
+        self._owner = {port.id: handle for handle in self._handles for port in handle.ports}
+        self._tables: dict[str, ValueTable] = {}
+        self._last: dict[str, dict] = {}
+        self._errors: dict[str, str | None] = {}
+        self.stats = StatsEngine(list(self._ports))
+        self._subscribers: set[_Subscriber] = set()
+        self._clients: dict[asyncio.Task, asyncio.StreamWriter] = {}
+        self._ids = itertools.count(1)
+        self._context = multiprocessing.get_context("spawn")
+        self._server = None
+        self._watch_task = None
+
+    async def start(self) -> None:
+        prefix = f"cu300_{os.getpid()}_"
+        for idx, port in enumerate(self._ports.values()):
+            self._tables[port.id] = ValueTable.create(f"{prefix}{idx}", port.names)
+        for handle in self._handles:
+            self._spawn(handle)
+        self._server = await asyncio.start_unix_server(self._serve, path=self._socket_path)
+        if self._stream_config:
+            await self.stream.start(**self._stream_config)
+        self._watch_task = asyncio.create_task(self._watch())
+        _LOGGER.info("Gateway serving %d ports with %d workers on %s", len(self._ports), len(self._handles), self._socket_path)
+
+    async def stop(self) -> None:
+        if self._watch_task:
+            self._watch_task.cancel()
+        if self._server:
+            self._server.close()
+        for writer in self._clients.values():
+            writer.close()
+        await asyncio.gather(*self._clients, return_exceptions=True)
+        await self.stream.stop()
+        for handle in self._handles:
+            self._retire(handle, stop=True)
+        for table in self._tables.values():
+            table.close()
+        self._tables.clear()
+        if os.path.exists(self._socket_path):
+            os.unlink(self._socket_path)
+
+    # Workers.
+
+    def _spawn(self, handle: _WorkerHandle) -> None:
+        parent, child = self._context.Pipe()
+        tables = {port.id: self._tables[port.id].name for port in handle.ports}
+        handle.process = self._context.Process(
+            target=run_worker,
+            args=(handle.ports, tables, child, self._client_shares),
+            name=f"cu300-worker-{handle.index}",
+            daemon=True,
+        )
+        handle.process.start()
+        child.close()
+        handle.conn = parent
+        asyncio.get_running_loop().add_reader(parent.fileno(), self._on_worker_message, handle)
+
+    def _retire(self, handle: _WorkerHandle, stop: bool = False) -> None:
+        """Detach from a worker; pending commands fail."""
+        if handle.conn is not None:
+            asyncio.get_running_loop().remove_reader(handle.conn.fileno())
+            if stop:
+                try:
+                    handle.conn.send(("stop", ))
+                except OSError:
+                    pass
+            handle.conn.close()
+            handle.conn = None
+        if stop and handle.process is not None:
+            handle.process.join(5)
+            if handle.process.is_alive():
+                handle.process.kill()
+        for future in handle.pending.values():
+            if not future.done():
+                future.set_exception(ConnectionError(f"Worker {handle.index} exited"))
+        handle.pending.clear()
+
+    async def _watch(self) -> None:
+        while True:
+            await asyncio.sleep(WATCH_INTERVAL)
+            self._sweep_stats()
+            for subscriber in list(self._subscribers):
+                if subscriber.missed and not self._lagging(subscriber):
+                    self._resync(subscriber)
+            now = time.monotonic()
+            for handle in self._handles:
+                if handle.process is None or handle.process.is_alive():
+                    continue
+                if handle.conn is not None:
+                    _LOGGER.error("Worker %d exited with code %s", handle.index, handle.process.exitcode)
+                    self._retire(handle)
+                    handle.restart_at = now + min(2.0 ** handle.restarts, MAX_RESTART_DELAY)
+                    for port in handle.ports:
+                        self._errors[port.id] = "worker exited"
+                elif now >= handle.restart_at:
+                    handle.restarts += 1
+                    _LOGGER.info("Restarting worker %d", handle.index)
+                    self._spawn(handle)
+
+    def _on_worker_message(self, handle: _WorkerHandle) -> None:
+        try:
+            message = handle.conn.recv()
+        except (EOFError, OSError):
+            asyncio.get_running_loop().remove_reader(handle.conn.fileno())
+            return
+        kind = message[0]
+        if kind == "update":
+            self._errors[message[1]] = None
+            self._publish(message[1])
+        elif kind == "error":
+            self._errors[message[1]] = message[2]
+        elif kind == "result":
+            _, request_id, ok, payload = message
+            future = handle.pending.pop(request_id, None)
+            if future is not None and not future.done():
+                if ok:
+                    future.set_result(payload)
+                else:
+                    future.set_exception(RuntimeError(payload))
+
+    def _publish(self, port_id: str) -> None:
+        seq, values = self._tables[port_id].read()
+        last = self._last.get(port_id, {})
+        changed = {name: value for name, value in values.items() if last.get(name) != value}
+        self._last[port_id] = values
+        self.stats.load(port_id, values)
+        self.stream.publish(port_id, values)
+        if not changed:
+            return
+        line = self._encode({"event": "update", "port": port_id, "seq": seq, "values": changed})
+        for subscriber in list(self._subscribers):
+            if subscriber.ports is None or port_id in subscriber.ports:
+                self._write(subscriber, line, port_id)
+
+    def _sweep_stats(self) -> None:
+        for event in self.stats.sweep():
+            line = self._encode({
+                "event": "threshold", "port": event.slave, "metric": event.metric, "kind": event.kind,
+                "state": event.state, "value": event.value, "zscore": event.zscore,
+            })
+            for subscriber in list(self._subscribers):
+                if subscriber.ports is None or event.slave in subscriber.ports:
+                    self._write(subscriber, line)
+
+    def _write(self, subscriber: _Subscriber, line: bytes, port_id: str | None = None) -> None:
+        """Queue `line` (an update of `port_id`, if given) unless the subscriber lags behind."""
+        if self._lagging(subscriber):
+            if port_id is not None:
+                subscriber.missed.add(port_id)
+            return
+        if subscriber.missed:
+            covered = port_id in subscriber.missed
+            self._resync(subscriber)
+            if covered:
+                return
+        subscriber.writer.write(line)
+
+    def _lagging(self, subscriber: _Subscriber) -> bool:
+        if subscriber.writer.is_closing():
+            self._subscribers.discard(subscriber)
+            return True
+        return subscriber.writer.transport.get_write_buffer_size() > MAX_BUFFER
+
+    def _resync(self, subscriber: _Subscriber) -> None:
+        """Full values of the ports the subscriber missed updates of."""
+        for port_id in sorted(subscriber.missed):
+            seq, values = self._tables[port_id].read()
+            subscriber.writer.write(self._encode({"event": "update", "port": port_id, "seq": seq, "values": values, "resync": True}))
+        subscriber.missed.clear()
+
+    # API.
+
+    def query(self, port_id: str | None = None) -> dict:
+        if port_id is not None and port_id not in self._tables:
+            raise KeyError(f"Unknown port: {port_id}")
+        result = {}
+        for pid in ([port_id] if port_id else self._tables):
+            seq, values = self._tables[pid].read()
+            result[pid] = {"seq": seq, "values": values, "error": self._errors.get(pid)}
+        return result
+
+    async def command(self, port_id: str, command: str, args: list, client: str = "default") -> dict:
+        handle = self._owner.get(port_id)
+        if handle is None:
+            raise KeyError(f"Unknown port: {port_id}")
+        if handle.conn is None:
+            raise ConnectionError(f"Worker for {port_id} is restarting")
+        request_id = next(self._ids)
+        future = handle.pending[request_id] = asyncio.get_running_loop().create_future()
+        handle.conn.send(("command", request_id, port_id, command, list(args), client))
+        try:
+            return await asyncio.wait_for(future, timeout=COMMAND_TIMEOUT)
+        finally:
+            handle.pending.pop(request_id, None)
+
+    async def _serve(self, reader: asyncio.StreamReader, writer: asyncio.StreamWriter) -> None:
+        subscriber = None
+        anonymous = f"conn{next(self._ids)}"
+        self._clients[asyncio.current_task()] = writer
+        try:
+            while line := await reader.readline():
+                try:
+                    request = json.loads(line)
+                    op = request.get("op")
+                    if op == "query":
+                        reply = {"ok": True, "ports": self.query(request.get("port"))}
+                    elif op == "subscribe":
+                        ports = request.get("ports")
+                        if subscriber is not None:
+                            self._subscribers.discard(subscriber)
+                        subscriber = _Subscriber(writer, set(ports) if ports else None)
+                        self._subscribers.add(subscriber)
+                        reply = {"ok": True}
+                    elif op == "command":
+                        result = await self.command(
+                            request["port"], request["command"], request.get("args", []), request.get("client", anonymous)
+                        )
+                        reply = {"ok": True, "result": result}
+                    elif op == "read":
+                        result = await self.command(
+                            request["port"], "read_datapoints", [list(request["datapoints"])], request.get("client", anonymous)
+                        )
+                        reply = {"ok": True, "result": result}
+                    else:
+                        raise ValueError(f"Unknown op: {op}")
+                except Exception as err:
+                    reply = {"ok": False, "error": str(err)}
+                writer.write(self._encode(reply))
+                await writer.drain()
+        except (ConnectionError, asyncio.IncompleteReadError):
+            pass
+        finally:
+            if subscriber is not None:
+                self._subscribers.discard(subscriber)
+            self._clients.pop(asyncio.current_task(), None)
+            writer.close()
+
+    @staticmethod
+    def _encode(message: dict) -> bytes:
+        return (json.dumps(message) + "\n").encode()
@@ -0,0 +1,262 @@
+"""Delta-encoded value subscriptions of the gateway.
+
+For consumers that only want decoded values as they change (historians,
+dashboards), the aggregator also serves a binary stream on its own Unix
+and/or TCP socket. Every poll published into the value tables is fanned out
+from memory, so any number of subscribers are served without a single
+extra telegram on the bus.
+
+A client subscribes with one JSON line (sent again to change it):
+
+    {"op": "subscribe", "keys": [["p1", "head", 0.1], ["p1", "flow", 0], ["p2", "*", 0.5]]}
+
+i.e. (port, datapoint, deadband) triples, "*" standing for all datapoints
+of the port. From then on the server only sends frames:
+
+    type u8, seq u32, length u32, payload
+
+    KEYS      JSON {"keys": [[port, datapoint], ...]}; the index is the key id
+    SNAPSHOT  current values of all subscribed keys
+    DELTA     values that moved by more than their deadband since last sent
+    ERROR     JSON {"error": message}; the subscription is unchanged
+
+Values are encoded as a count, then per value the key id (delta from the
+previous, ids ascending) shifted left by one, its low bit set for a float64
+to follow; a clear bit means a zigzag varint follows, used for integral
+values. All varints are LEB128.
+
+Every frame takes the next sequence number. A subscriber that does not read
+fast enough has DELTA frames dropped, which still take their number; the
+gap tells it values were lost, and the next frame is a SNAPSHOT to resync
+from. Changes of all ports published in the same loop iteration go out in
+one DELTA frame.
+"""
+import asyncio
+import json
+import logging
+import math
+import os
+import struct
+from dataclasses import dataclass, field
+
+from ..utils.bytes import putVarint, getVarint, zigzag, unzigzag
+
+_LOGGER = logging.getLogger(__name__)
+
+KEYS = 1
+SNAPSHOT = 2
+DELTA = 3
+ERROR = 4
+
+WILDCARD = "*"
+
+# Write buffer of a subscriber above which DELTA frames are dropped.
+MAX_BUFFER = 256 * 1024
+
+_FRAME = struct.Struct("<BII")
+_DOUBLE = struct.Struct("<d")
+
+
+def encode_values(values: dict[int, float]) -> bytes:
+    """Payload of a SNAPSHOT or DELTA frame from key id -> value."""
+    out = bytearray()
+    putVarint(out, len(values))
+    previous = 0
+    for key in sorted(values):
+        value = float(values[key])
+        if value.is_integer() and abs(value) < 2 ** 53:
+            putVarint(out, (key - previous) << 1)
+            number = int(value)
+            putVarint(out, zigzag(number))
+        else:
+            putVarint(out, ((key - previous) << 1) | 1)
+            out += _DOUBLE.pack(value)
+        previous = key
+    return bytes(out)
+
+
+def decode_values(payload: bytes) -> dict[int, float]:
+    data = memoryview(payload)
+    count, pos = getVarint(data, 0)
+    values = {}
+    key = 0
+    for _ in range(count):
+        tag, pos = getVarint(data, pos)
+        key += tag >> 1
+        if tag & 1:
+            values[key] = _DOUBLE.unpack_from(data, pos)[0]
+            pos += _DOUBLE.size
+        else:
+            number, pos = getVarint(data, pos)
+            values[key] = float(unzigzag(number))
+    return values
+
+
+def encode_frame(kind: int, seq: int, payload: bytes) -> bytes:
+    return _FRAME.pack(kind, seq & 0xffffffff, len(payload)) + payload
+
+
+async def read_frame(reader: asyncio.StreamReader) -> tuple[int, int, object]:
+    """Next (type, seq, content) from the stream; values or the decoded JSON."""
+    kind, seq, length = _FRAME.unpack(await reader.readexactly(_FRAME.size))
+    payload = await reader.readexactly(length)
+    if kind in (SNAPSHOT, DELTA):
+        return kind, seq, decode_values(payload)
+    return kind, seq, json.loads(payload)
+
+
+@dataclass(eq=False)
+class _Subscriber:
+    writer: asyncio.StreamWriter
+    keys: list[tuple[str, str]] = field(default_factory=list)
+    # port -> [(key id, datapoint, deadband)]
+    watch: dict[str, list[tuple[int, str, float]]] = field(default_factory=dict)
+    last: dict[int, float] = field(default_factory=dict)
+    pending: dict[int, float] = field(default_factory=dict)
+    seq: int = 0
+    resync: bool = False
+
+    def send(self, kind: int, payload: bytes) -> None:
+        self.writer.write(encode_frame(kind, self.seq, payload))
+        self.seq += 1
+
+
+class StreamServer:
+
+    def __init__(self, ports: dict[str, list[str]], max_buffer: int = MAX_BUFFER) -> None:
+        self._names = {port_id: list(names) for port_id, names in ports.items()}
+        self._max_buffer = max_buffer
+        self._values: dict[str, dict] = {}
+        self._by_port: dict[str, set[_Subscriber]] = {port_id: set() for port_id in ports}
+        self._subscribers: set[_Subscriber] = set()
+        self._dirty: set[_Subscriber] = set()
+        self._flush_handle: asyncio.Handle | None = None
+        self._servers: list[asyncio.AbstractServer] = []
+        self._tasks: set[asyncio.Task] = set()
+        self._socket_path = None
+
+    @property
+    def subscribers(self) -> int:
+        return len(self._subscribers)
+
+    async def start(self, socket: str | None = None, host: str | None = None, port: int | None = None) -> None:
+        if socket:
+            self._servers.append(await asyncio.start_unix_server(self._serve, path=socket))
+            self._socket_path = socket
+        if port is not None:
+            self._servers.append(await asyncio.start_server(self._serve, host, port))
+        _LOGGER.info("Value stream on %s", ", ".join(filter(None, (socket, port is not None and f"{host or '*'}:{port}"))))
+
+    async def stop(self) -> None:
+        for server in self._servers:
+            server.close()
+        for subscriber in self._subscribers:
+            subscriber.writer.close()
+        await asyncio.gather(*self._tasks, return_exceptions=True)
+        self._servers.clear()
+        if self._flush_handle is not None:
+            self._flush_handle.cancel()
+            self._flush_handle = None
+        if self._socket_path and os.path.exists(self._socket_path):
+            os.unlink(self._socket_path)
+
+    def publish(self, port_id: str, values: dict) -> None:
+        """Values of a poll; changes beyond the deadbands are queued for the next flush."""
+        self._values[port_id] = values
+        for subscriber in self._by_port.get(port_id, ()):
+            for key, name, deadband in subscriber.watch[port_id]:
+                value = values.get(name)
+                if value is None:
+                    continue
+                last = subscriber.last.get(key)
+                if last is None or abs(value - last) > deadband or (math.isnan(value) != math.isnan(last)):
+                    subscriber.pending[key] = value
+                    subscriber.last[key] = value
+            if subscriber.pending or subscriber.resync:
+                self._dirty.add(subscriber)
+        if self._dirty and self._flush_handle is None:
+            self._flush_handle = asyncio.get_running_loop().call_soon(self._flush)
+
+    def _flush(self) -> None:
+        self._flush_handle = None
+        dirty, self._dirty = self._dirty, set()
+        for subscriber in dirty:
+            if subscriber.writer.is_closing():
+                continue
+            if subscriber.writer.transport.get_write_buffer_size() > self._max_buffer:
+                # Dropped; the gap in the numbers tells the subscriber.
+                subscriber.seq += 1
+                subscriber.pending.clear()
+                subscriber.resync = True
+            elif subscriber.resync:
+                self._send_snapshot(subscriber)
+            elif subscriber.pending:
+                subscriber.send(DELTA, encode_values(subscriber.pending))
+                subscriber.pending.clear()
+
+    def _send_snapshot(self, subscriber: _Subscriber) -> None:
+        values = {}
+        for port_id, watched in subscriber.watch.items():
+            current = self._values.get(port_id, {})
+            for key, name, _ in watched:
+                if name in current:
+                    values[key] = current[name]
+        subscriber.last = dict(values)
+        subscriber.pending.clear()
+        subscriber.resync = False
+        subscriber.send(SNAPSHOT, encode_values(values))
+
+    def _subscribe(self, subscriber: _Subscriber, keys: list) -> None:
+        watch, resolved = {}, []
+        for entry in keys:
+            port_id, name, deadband = (list(entry) + [0.0])[:3]
+            if port_id not in self._names:
+                raise KeyError(f"Unknown port: {port_id}")
+            deadband = float(deadband)
+            if not deadband >= 0:
+                raise ValueError(f"Invalid deadband for {port_id}/{name}: {deadband}")
+            if name == WILDCARD:
+                names = self._names[port_id]
+            elif name in self._names[port_id]:
+                names = [name]
+            else:
+                raise KeyError(f"Unknown datapoint of {port_id}: {name}")
+            for datapoint in names:
+                watch.setdefault(port_id, []).append((len(resolved), datapoint, deadband))
+                resolved.append((port_id, datapoint))
+        self._unwatch(subscriber)
+        subscriber.keys, subscriber.watch = resolved, watch
+        for port_id in watch:
+            self._by_port[port_id].add(subscriber)
+        subscriber.send(KEYS, json.dumps({"keys": resolved}).encode())
+        self._send_snapshot(subscriber)
+
+    def _unwatch(self, subscriber: _Subscriber) -> None:
+        for port_id in subscriber.watch:
+            self._by_port[port_id].discard(subscriber)
+        self._dirty.discard(subscriber)
+
+    async def _serve(self, reader: asyncio.StreamReader, writer: asyncio.StreamWriter) -> None:
+        subscriber = _Subscriber(writer)
+        self._subscribers.add(subscriber)
+        task = asyncio.current_task()
+        self._tasks.add(task)
+        try:
+            while line := await reader.readline():
+                try:
+                    request = json.loads(line)
+                    op = request.get("op")
+                    if op == "subscribe":
+                        self._subscribe(subscriber, request["keys"])
+                    else:
+                        raise ValueError(f"Unknown op: {op}")
+                except Exception as err:
+                    subscriber.send(ERROR, json.dumps({"error": str(err)}).encode())
+                await writer.drain()
+        except (ConnectionError, asyncio.IncompleteReadError):
+            pass
+        finally:
+            self._unwatch(subscriber)
+            self._subscribers.discard(subscriber)
+            self._tasks.discard(task)
+            writer.close()
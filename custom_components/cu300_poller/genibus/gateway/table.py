@@ -0,0 +1,76 @@
+"""Per-port value tables in shared memory.
+
+The aggregator creates one table per port and owns it; the worker polling
+the port attaches and publishes every poll into it, so a worker that dies
+leaves the last values readable and its restarted successor just attaches
+again. Layout: one uint64 sequence counter followed by one float64 per
+datapoint (NaN = no value). The counter is odd while a write is in
+progress (seqlock), so readers never see a half-written poll.
+"""
+import math
+import struct
+from multiprocessing import shared_memory
+
+_SEQ = struct.Struct("<Q")
+_RETRIES = 100
+
+
+class ValueTable:
+
+    def __init__(self, shm: shared_memory.SharedMemory, names: list[str], owner: bool) -> None:
+        self._shm = shm
+        self.names = list(names)
+        self._index = {name: idx for idx, name in enumerate(self.names)}
+        self._values = struct.Struct(f"<{len(self.names)}d")
+        self._owner = owner
+
+    @classmethod
+    def create(cls, name: str, names: list[str]) -> "ValueTable":
+        shm = shared_memory.SharedMemory(name=name, create=True, size=_SEQ.size + 8 * max(len(names), 1))
+        table = cls(shm, names, owner=True)
+        table._values.pack_into(shm.buf, _SEQ.size, *([math.nan] * len(names)))
+        _SEQ.pack_into(shm.buf, 0, 0)
+        return table
+
+    @classmethod
+    def attach(cls, name: str, names: list[str]) -> "ValueTable":
+        # Workers are spawned by the aggregator and share its resource tracker,
+        # so the segment is still unlinked only once, by its creator.
+        return cls(shared_memory.SharedMemory(name=name), names, owner=False)
+
+    @property
+    def name(self) -> str:
+        return self._shm.name
+
+    def write(self, values: dict) -> int:
+        """Publish a poll; non-numeric values and names outside the layout are skipped."""
+        buf = self._shm.buf
+        seq = _SEQ.unpack_from(buf, 0)[0]
+        current = list(self._values.unpack_from(buf, _SEQ.size))
+        for name, value in values.items():
+            idx = self._index.get(name)
+            if idx is not None and isinstance(value, (int, float)):
+                current[idx] = float(value)
+        _SEQ.pack_into(buf, 0, seq + 1)
+        self._values.pack_into(buf, _SEQ.size, *current)
+        _SEQ.pack_into(buf, 0, seq + 2)
+        return seq + 2
+
+    def read(self) -> tuple[int, dict]:
+        """Consistent snapshot: (sequence, name -> value) without the missing ones."""
+        buf = self._shm.buf
+        for _ in range(_RETRIES):
+            before = _SEQ.unpack_from(buf, 0)[0]
+            if before & 1:
+                continue
+            values = self._values.unpack_from(buf, _SEQ.size)
+            if _SEQ.unpack_from(buf, 0)[0] == before:
+                return before, {
+                    name: value for name, value in zip(self.names, values) if not math.isnan(value)
+                }
+        raise BlockingIOError(f"Table {self.name} is being written continuously")
+
+    def close(self) -> None:
+        self._shm.close()
+        if self._owner:
+            self._shm.unlink()
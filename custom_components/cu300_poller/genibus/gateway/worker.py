@@ -0,0 +1,168 @@
+"""Gateway worker process: polls its shard of ports and publishes into the value tables.
+
+Messages to the aggregator (over a multiprocessing pipe):
+
+    ("update", port_id, seq)                  new values are in the port's table
+    ("error", port_id, message)               a poll failed
+    ("result", request_id, ok, payload)       outcome of a command
+
+and from it:
+
+    ("command", request_id, port_id, command, args, client)
+    ("stop", )
+
+Polling is charged to the bus client "poll", commands to the client that
+sent them; see linklayer/fairshare.py. A failed poll, whatever the cause, is
+reported and retried the next interval; should a port task end anyway, the
+worker exits, so the aggregator restarts it.
+"""
+import asyncio
+import logging
+import sys
+from dataclasses import dataclass, field
+
+from ..exceptions import GENIBusError, ConnectionError as CU300ConnectionError
+from ..linklayer import fairshare
+from ..protocol import CU300Protocol, DATA_KEYS
+from .table import ValueTable
+
+_LOGGER = logging.getLogger(__name__)
+
+COMMANDS = ("start_pump", "stop_pump", "set_reference", "read_datapoints")
+
+POLL_CLIENT = "poll"
+
+POLL_TIMEOUT = 10
+COMMAND_TIMEOUT = 5
+
+
+@dataclass(frozen=True)
+class PortConfig:
+    id: str
+    connection_type: str
+    port: str | None = None
+    host: str | None = None
+    device_addr: int = 0x20
+    datapoints: tuple[str, ...] = field(default_factory=tuple)
+    interval: float = 30.0
+    baudrate: int = 9600
+
+    @property
+    def names(self) -> list[str]:
+        """Layout of the port's value table."""
+        return list(DATA_KEYS.values()) + sorted(set(self.datapoints) - set(DATA_KEYS))
+
+
+def run_worker(ports: list[PortConfig], tables: dict[str, str], conn, clients: dict[str, dict] | None = None) -> None:
+    """Process entry point."""
+    logging.basicConfig(level=logging.INFO)
+    code = asyncio.run(Worker(ports, tables, conn, clients).run())
+    if code:
+        sys.exit(code)
+
+
+class Worker:
+
+    def __init__(self, ports: list[PortConfig], tables: dict[str, str], conn, clients: dict[str, dict] | None = None) -> None:
+        self._ports = ports
+        self._clients = clients or {}
+        self._conn = conn
+        self._tables = {port.id: ValueTable.attach(tables[port.id], port.names) for port in ports}
+        self._protocols: dict[str, CU300Protocol] = {}
+        self._stopped: asyncio.Event | None = None
+        self._exit_code = 0
+
+    async def run(self) -> int:
+        """Poll until stopped; the exit code of the process."""
+        loop = asyncio.get_running_loop()
+        self._stopped = asyncio.Event()
+        loop.add_reader(self._conn.fileno(), self._on_message)
+        tasks = [asyncio.create_task(self._poll(port)) for port in self._ports]
+        for task in tasks:
+            task.add_done_callback(self._on_poll_done)
+        try:
+            await self._stopped.wait()
+        finally:
+            loop.remove_reader(self._conn.fileno())
+            for task in tasks:
+                task.cancel()
+            await asyncio.gather(*tasks, return_exceptions=True)
+            for protocol in self._protocols.values():
+                await protocol.disconnect()
+            for table in self._tables.values():
+                table.close()
+        return self._exit_code
+
+    async def _poll(self, port: PortConfig) -> None:
+        loop = asyncio.get_running_loop()
+        protocol = self._protocols[port.id] = CU300Protocol(
+            connection_type=port.connection_type,
+            host=port.host,
+            port=port.port,
+            device_addr=port.device_addr,
+            baudrate=port.baudrate,
+        )
+        protocol.set_datapoints(port.datapoints)
+        for name, share in self._clients.items():
+            protocol.scheduler.configure(name, **share)
+        # Each task runs in its own context, so this tags the polls of this port only.
+        fairshare.bus_client.set(POLL_CLIENT)
+        connected = False
+        while True:
+            started = loop.time()
+            try:
+                if not connected:
+                    await protocol.connect()
+                    connected = True
+                values = await asyncio.wait_for(protocol.poll_data(), timeout=POLL_TIMEOUT)
+                self._send("update", port.id, self._tables[port.id].write(values))
+            except (GENIBusError, asyncio.TimeoutError, OSError) as err:
+                _LOGGER.warning("Polling %s failed: %s", port.id, err)
+                self._send("error", port.id, str(err))
+                if connected and isinstance(err, (CU300ConnectionError, asyncio.TimeoutError, OSError)):
+                    connected = False
+                    await protocol.disconnect()
+            except Exception as err:
+                # A bug must not silently end the port's polling; start over on a fresh connection.
+                _LOGGER.exception("Unexpected error polling %s", port.id)
+                self._send("error", port.id, f"Unexpected error: {err}")
+                if connected:
+                    connected = False
+                    await protocol.disconnect()
+            await asyncio.sleep(max(0.0, port.interval - (loop.time() - started)))
+
+    def _on_poll_done(self, task: asyncio.Task) -> None:
+        if not task.cancelled() and not self._stopped.is_set():
+            _LOGGER.error("Polling task ended, exiting the worker", exc_info=task.exception())
+            self._exit_code = 1
+            self._stopped.set()
+
+    def _on_message(self) -> None:
+        try:
+            message = self._conn.recv()
+        except (EOFError, OSError):
+            # The aggregator is gone.
+            self._stopped.set()
+            return
+        if message[0] == "stop":
+            self._stopped.set()
+        elif message[0] == "command":
+            asyncio.create_task(self._command(*message[1:]))
+
+    async def _command(self, request_id: int, port_id: str, command: str, args: list, client: str) -> None:
+        try:
+            if command not in COMMANDS:
+                raise ValueError(f"Unknown command: {command}")
+            protocol = self._protocols[port_id]
+            with fairshare.client(client):
+                readback = await asyncio.wait_for(getattr(protocol, command)(*args), timeout=COMMAND_TIMEOUT)
+            self._send("update", port_id, self._tables[port_id].write(readback))
+            self._send("result", request_id, True, readback)
+        except Exception as err:
+            self._send("result", request_id, False, str(err))
+
+    def _send(self, *message) -> None:
+        try:
+            self._conn.send(message)
+        except (BrokenPipeError, OSError):
+            self._stopped.set()
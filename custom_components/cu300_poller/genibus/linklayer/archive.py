@@ -0,0 +1,299 @@
+"""Compressed long-term archive of recorded bus sessions.
+
+Session files (see session.py) are compacted into blocks of a few thousand
+transactions. Each block is stored column by column:
+
+    t      request offsets in microseconds, delta from the previous one
+    rtt    turnaround in microseconds
+    da     destination address + 1 (0 = unknown)
+    error  index into the block's error strings + 1 (0 = no error)
+    req    index into the block's request templates
+    rep    reply length/kind + reply bytes, XOR'ed with the previous reply
+           to the same request template when the length is unchanged
+
+so the request templates are stored once per block and slowly drifting
+values leave mostly zero bytes behind. Each block is deflated with a
+dictionary trained on the first blocks of the archive and is self-contained,
+so a block-level time index at the end of the file lets readers seek to a
+point in time and decompress only the blocks they need.
+
+Layout: magic, dictionary, JSON metadata, blocks, index, footer (index
+offset, block count, magic). `load_session()` reads archives transparently,
+so a `ReplayConnection` can replay them directly.
+"""
+import bisect
+import json
+import os
+import struct
+import zlib
+
+from ..utils.bytes import putVarint, getVarint, zigzag, unzigzag
+
+ARCHIVE_MAGIC = b"GBAR\x01"
+INDEX_MAGIC = b"GBIX"
+ARCHIVE_VERSION = 1
+
+BLOCK_SIZE = 4096
+DICT_SIZE = 16 * 1024       # zlib only looks back 32KiB.
+TRAINING_BLOCKS = 2
+
+_LENGTH = struct.Struct("<I")
+_INDEX_ENTRY = struct.Struct("<ddQII")      # t_first, t_last, offset, size, count
+_FOOTER = struct.Struct("<QI4s")
+
+
+def _xor(data: bytes, previous: bytes) -> bytes:
+    return (int.from_bytes(data, "little") ^ int.from_bytes(previous, "little")).to_bytes(len(data), "little")
+
+
+def _put_section(out: bytearray, section: bytes) -> None:
+    putVarint(out, len(section))
+    out += section
+
+
+def _put_strings(out: bytearray, strings: list) -> None:
+    section = bytearray()
+    putVarint(section, len(strings))
+    for value in strings:
+        _put_section(section, value)
+    _put_section(out, section)
+
+
+def encode_block(transactions: list[dict], base: float) -> bytes:
+    """Columnar, uncompressed encoding of a run of transactions; `t` is absolute."""
+    templates, template_index = [], {}
+    errors, error_index = [], {}
+    times, rtts, das, codes, reqs, reps = (bytearray() for _ in range(6))
+    previous_t = round(base * 1e6)
+    last_reply = {}
+    for entry in transactions:
+        t = round(entry["t"] * 1e6)
+        putVarint(times, zigzag(t - previous_t))
+        previous_t = t
+        putVarint(rtts, max(round(entry["rtt"] * 1e6), 0))
+        putVarint(das, 0 if entry["da"] is None else entry["da"] + 1)
+        error = entry.get("error")
+        if error is None:
+            putVarint(codes, 0)
+        else:
+            if error not in error_index:
+                error_index[error] = len(errors)
+                errors.append(error.encode("utf-8"))
+            putVarint(codes, error_index[error] + 1)
+        request = entry["req"]
+        if request not in template_index:
+            template_index[request] = len(templates)
+            templates.append(bytes.fromhex(request))
+        tid = template_index[request]
+        putVarint(reqs, tid)
+        if entry["rep"] is None:
+            putVarint(reps, 0)
+            continue
+        reply = bytes.fromhex(entry["rep"])
+        previous = last_reply.get(tid)
+        delta = previous is not None and len(previous) == len(reply)
+        putVarint(reps, ((len(reply) << 1) | delta) + 1)
+        reps += _xor(reply, previous) if delta else reply
+        last_reply[tid] = reply
+    out = bytearray()
+    putVarint(out, len(transactions))
+    _put_strings(out, templates)
+    _put_strings(out, errors)
+    for column in (times, rtts, das, codes, reqs, reps):
+        _put_section(out, column)
+    return bytes(out)
+
+
+def _get_section(data, pos: int) -> tuple[memoryview, int]:
+    length, pos = getVarint(data, pos)
+    return data[pos : pos + length], pos + length
+
+
+def _get_strings(data, pos: int) -> tuple[list, int]:
+    section, pos = _get_section(data, pos)
+    count, spos = getVarint(section, 0)
+    strings = []
+    for _ in range(count):
+        value, spos = _get_section(section, spos)
+        strings.append(bytes(value))
+    return strings, pos
+
+
+def decode_block(data: bytes, base: float) -> list[dict]:
+    """Inverse of `encode_block()`; yields session-style transactions."""
+    data = memoryview(data)
+    count, pos = getVarint(data, 0)
+    templates, pos = _get_strings(data, pos)
+    errors, pos = _get_strings(data, pos)
+    columns = []
+    for _ in range(6):
+        column, pos = _get_section(data, pos)
+        columns.append(column)
+    times, rtts, das, codes, reqs, reps = columns
+    cursor = [0] * 5
+    rpos = 0
+    previous_t = round(base * 1e6)
+    last_reply = {}
+    result = []
+    for _ in range(count):
+        values = []
+        for idx, column in enumerate((times, rtts, das, codes, reqs)):
+            value, cursor[idx] = getVarint(column, cursor[idx])
+            values.append(value)
+        dt, rtt, da, code, tid = values
+        previous_t += unzigzag(dt)
+        kind, rpos = getVarint(reps, rpos)
+        reply = None
+        if kind:
+            length, delta = (kind - 1) >> 1, (kind - 1) & 1
+            reply = bytes(reps[rpos : rpos + length])
+            rpos += length
+            if delta:
+                reply = _xor(reply, last_reply[tid])
+            last_reply[tid] = reply
+        result.append({
+            "t": previous_t / 1e6,
+            "da": da - 1 if da else None,
+            "req": templates[tid].hex(),
+            "rep": reply.hex() if reply is not None else None,
+            "rtt": rtt / 1e6,
+            "error": errors[code - 1].decode("utf-8") if code else None,
+        })
+    return result
+
+
+def train_dictionary(samples: list[bytes], size: int = DICT_SIZE) -> bytes:
+    """Dictionary for the archive from encoded sample blocks.
+
+    zlib matches against the dictionary like against already seen data, so
+    the request templates and raw first replies every block starts with are
+    found there; the most recent (i.e. last) bytes are the cheapest to
+    reference, hence the most common prefix of the samples goes last.
+    """
+    dictionary = b"".join(sample[: size // max(len(samples), 1)] for sample in reversed(samples))
+    return dictionary[-size:]
+
+
+def is_archive(path: str) -> bool:
+    try:
+        with open(path, "rb") as fp:
+            return fp.read(len(ARCHIVE_MAGIC)) == ARCHIVE_MAGIC
+    except OSError:
+        return False
+
+
+def _segment(path: str):
+    """Transactions of a session segment with absolute timestamps."""
+    from .session import read_segments
+
+    with open(path, encoding="utf-8") as fp:
+        for created, entry in read_segments(fp):
+            entry["t"] += created
+            yield created, entry
+
+
+def compact_sessions(paths: list[str], archive: str, block_size: int = BLOCK_SIZE) -> dict:
+    """Compact one or more session segments, in order, into an archive.
+
+    Returns the sizes before and after and the number of transactions.
+    """
+    created, blocks, run = None, [], []
+    for path in paths:
+        for segment_created, entry in _segment(path):
+            if created is None:
+                created = segment_created
+            run.append(entry)
+            if len(run) >= block_size:
+                blocks.append(run)
+                run = []
+    if run:
+        blocks.append(run)
+    created = created or 0.0
+    encoded = [encode_block(block, block[0]["t"]) for block in blocks]
+    dictionary = train_dictionary(encoded[:TRAINING_BLOCKS])
+    meta = json.dumps({"version": ARCHIVE_VERSION, "created": created, "segments": [os.path.basename(p) for p in paths]}).encode("utf-8")
+    index = []
+    with open(archive, "wb") as fp:
+        fp.write(ARCHIVE_MAGIC)
+        for section in (dictionary, meta):
+            fp.write(_LENGTH.pack(len(section)))
+            fp.write(section)
+        for block, payload in zip(blocks, encoded):
+            compressor = zlib.compressobj(9, zdict=dictionary) if dictionary else zlib.compressobj(9)
+            data = compressor.compress(payload) + compressor.flush()
+            index.append((block[0]["t"], block[-1]["t"], fp.tell(), len(data), len(block)))
+            fp.write(data)
+        index_offset = fp.tell()
+        for entry in index:
+            fp.write(_INDEX_ENTRY.pack(*entry))
+        fp.write(_FOOTER.pack(index_offset, len(index), INDEX_MAGIC))
+        size = fp.tell()
+    return {
+        "transactions": sum(entry[4] for entry in index),
+        "blocks": len(index),
+        "original": sum(os.path.getsize(p) for p in paths),
+        "compressed": size,
+    }
+
+
+class ArchiveReader:
+    """Random access to the blocks of an archive.
+
+    Timestamps are offsets from the start of the first segment, like in a
+    session file; `transactions(start, end)` seeks through the index and
+    decompresses one block at a time.
+    """
+
+    def __init__(self, path: str) -> None:
+        self._path = path
+        with open(path, "rb") as fp:
+            if fp.read(len(ARCHIVE_MAGIC)) != ARCHIVE_MAGIC:
+                raise ValueError(f"Not a session archive: {path}")
+            self._dictionary = fp.read(_LENGTH.unpack(fp.read(_LENGTH.size))[0])
+            meta = json.loads(fp.read(_LENGTH.unpack(fp.read(_LENGTH.size))[0]))
+            if meta.get("version") != ARCHIVE_VERSION:
+                raise ValueError(f"Unsupported archive version: {meta.get('version')}")
+            fp.seek(-_FOOTER.size, os.SEEK_END)
+            index_offset, count, magic = _FOOTER.unpack(fp.read(_FOOTER.size))
+            if magic != INDEX_MAGIC:
+                raise ValueError(f"Truncated session archive: {path}")
+            fp.seek(index_offset)
+            raw = fp.read(count * _INDEX_ENTRY.size)
+        self.meta = meta
+        self.created = meta["created"]
+        self.index = [_INDEX_ENTRY.unpack_from(raw, idx * _INDEX_ENTRY.size) for idx in range(count)]
+        self._ends = [entry[1] - self.created for entry in self.index]
+
+    def __len__(self) -> int:
+        return sum(entry[4] for entry in self.index)
+
+    def read_block(self, number: int, fp=None) -> list[dict]:
+        t_first, _, offset, size, _ = self.index[number]
+        if fp is None:
+            with open(self._path, "rb") as fp:
+                return self.read_block(number, fp)
+        fp.seek(offset)
+        decompressor = zlib.decompressobj(zdict=self._dictionary) if self._dictionary else zlib.decompressobj()
+        transactions = decode_block(decompressor.decompress(fp.read(size)), t_first)
+        for entry in transactions:
+            entry["t"] = round(entry["t"] - self.created, 6)
+        return transactions
+
+    def transactions(self, start: float = None, end: float = None):
+        first = 0 if start is None else bisect.bisect_left(self._ends, start)
+        with open(self._path, "rb") as fp:
+            for number in range(first, len(self.index)):
+                if end is not None and self.index[number][0] - self.created > end:
+                    return
+                for entry in self.read_block(number, fp):
+                    if start is not None and entry["t"] < start:
+                        continue
+                    if end is not None and entry["t"] > end:
+                        return
+                    yield entry
+
+    def frames(self, start: float = None, end: float = None):
+        """(t, request, reply) byte strings, e.g. to feed a link layer for replay."""
+        for entry in self.transactions(start, end):
+            reply = bytes.fromhex(entry["rep"]) if entry["rep"] is not None else None
+            yield entry["t"], bytes.fromhex(entry["req"]), reply
@@ -2,6 +2,18 @@
 import abc
 import asyncio
 
+from .. import gbdefs
+from ..exceptions import InvalidFrameError, ConnectionError as CU300ConnectionError
+
+# Silence on the line after which discard_input() considers it drained.
+DISCARD_QUIET = 0.02
+
+START_DELIMITERS = (
+    gbdefs.FrameType.SD_DATA_REQUEST,
+    gbdefs.FrameType.SD_DATA_REPLY,
+    gbdefs.FrameType.SD_DATA_MESSAGE,
+)
+
 class Connection(metaclass=abc.ABCMeta):
     """Abstract base class for GENIBus connections."""
 
@@ -27,4 +39,51 @@ class Connection(metaclass=abc.ABCMeta):
     @abc.abstractmethod
     async def read(self, size=1):
         """Read data from the device."""
-        pass
\ No newline at end of file
+        pass
+
+    async def discard_input(self, quiet: float = DISCARD_QUIET) -> int:
+        """Throw away what is buffered or still arriving until the line was quiet for `quiet` seconds.
+
+        Returns the number of bytes discarded.
+        """
+        discarded = 0
+        while True:
+            try:
+                data = await asyncio.wait_for(self.read(256), timeout=quiet)
+            except asyncio.TimeoutError:
+                return discarded
+            if not data:
+                return discarded
+            discarded += len(data)
+
+    async def read_frame(self, resync: bool = False) -> bytearray:
+        """Read one complete telegram (start delimiter up to and including CRC).
+
+        Reads are served from the StreamReader's buffer, so a telegram split
+        across several TCP segments or serial chunks is reassembled instead of
+        being reported as incomplete. With `resync`, bytes before the next start
+        delimiter are skipped instead of failing the frame.
+        """
+        if not self._reader:
+            raise CU300ConnectionError("No active connection")
+
+        try:
+            start = await self._reader.readexactly(1)
+            while resync and start[0] not in START_DELIMITERS:
+                start = await self._reader.readexactly(1)
+            head = start + await self._reader.readexactly(1)
+            if head[0] not in START_DELIMITERS:
+                raise InvalidFrameError(f"Invalid start delimiter: 0x{head[0]:02x}")
+            length = head[1]
+            if length > gbdefs.MAX_PDU_LEN:
+                raise InvalidFrameError(f"Invalid frame length: {length}")
+            # Remaining data: length + 2 bytes CRC.
+            remaining = await self._reader.readexactly(length + 2)
+        except asyncio.IncompleteReadError as err:
+            if not err.partial:
+                raise InvalidFrameError("No data received") from err
+            raise InvalidFrameError(
+                f"Incomplete frame: expected {err.expected}, got {len(err.partial)}"
+            ) from err
+
+        return bytearray(head + remaining)
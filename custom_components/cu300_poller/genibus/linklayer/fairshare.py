@@ -0,0 +1,188 @@
+"""Weighted fair sharing of bus time between the clients of one bus.
+
+Every transaction is charged to the client holding the bus, by the time it
+kept the wire busy: the bytes of request and reply at the line's baud rate,
+or the time spent waiting in case of a timeout. The bus is then granted in
+start-time fair queuing order, so over time each client that has work
+queued gets bus time in proportion to its weight, however large or
+frequent its requests are. A client may also have a budget, a hard cap on
+its share of the bus time (0.25 = a quarter), enforced by a token bucket
+of wire-seconds; over budget, it waits even if the bus is idle.
+
+The client of a request is taken from the `bus_client` context variable,
+so callers tag their work once instead of passing it down:
+
+    with client("dashboard"):
+        await protocol.read_datapoints(names)
+"""
+import asyncio
+import contextlib
+import contextvars
+import itertools
+import time
+from dataclasses import dataclass, field
+
+DEFAULT_CLIENT = "default"
+
+# Start bit, 8 data bits, stop bit.
+BITS_PER_CHARACTER = 10
+
+# A budgeted client may save up this many seconds' worth of its budget.
+BUDGET_WINDOW = 1.0
+
+bus_client = contextvars.ContextVar("bus_client", default=DEFAULT_CLIENT)
+
+
+@contextlib.contextmanager
+def client(name: str):
+    """Charge the bus time of the enclosed requests to `name`."""
+    token = bus_client.set(name)
+    try:
+        yield
+    finally:
+        bus_client.reset(token)
+
+
+@dataclass
+class _Client:
+    weight: float = 1.0
+    budget: float | None = None
+    finish: float = 0.0         # Virtual finish time of the last queued slot.
+    estimate: float = 0.0       # Cost of the last slot, assumed for the next one.
+    tokens: float = 0.0
+    stamp: float = 0.0
+    used: float = 0.0
+    slots: int = 0
+
+
+@dataclass(order=True)
+class _Waiter:
+    start: float
+    seq: int
+    client: str = field(compare=False)
+    future: asyncio.Future = field(compare=False)
+
+
+class BusScheduler:
+
+    def __init__(self, baudrate: int = 9600, bits_per_character: int = BITS_PER_CHARACTER, clock=time.monotonic) -> None:
+        self.baudrate = baudrate
+        self.bits_per_character = bits_per_character
+        self._clock = clock
+        self._clients: dict[str, _Client] = {}
+        self._queue: list[_Waiter] = []
+        self._seq = itertools.count()
+        self._virtual = 0.0
+        self._holder: _Waiter | None = None
+        self._charged = 0.0
+        self._timer: asyncio.TimerHandle | None = None
+
+    def configure(self, name: str, weight: float = 1.0, budget: float | None = None) -> None:
+        if weight <= 0 or (budget is not None and not 0 < budget <= 1):
+            raise ValueError(f"Invalid share for {name}: weight {weight}, budget {budget}")
+        state = self._client(name)
+        state.weight = weight
+        state.budget = budget
+        state.tokens = budget * BUDGET_WINDOW if budget else 0.0
+        state.stamp = self._clock()
+
+    def wire_time(self, nbytes: int) -> float:
+        return nbytes * self.bits_per_character / self.baudrate
+
+    def charge(self, nbytes: int, busy: float = 0.0) -> None:
+        """Account a transaction to the current holder of the bus."""
+        self._charged += max(self.wire_time(nbytes), busy)
+
+    async def acquire(self, name: str | None = None) -> None:
+        name = name or bus_client.get()
+        state = self._client(name)
+        start = max(self._virtual, state.finish)
+        state.finish = start + state.estimate / state.weight
+        waiter = _Waiter(start, next(self._seq), name, asyncio.get_running_loop().create_future())
+        self._queue.append(waiter)
+        self._dispatch()
+        try:
+            await waiter.future
+        except asyncio.CancelledError:
+            if self._holder is waiter:
+                self.release()
+            elif waiter in self._queue:
+                self._queue.remove(waiter)
+            raise
+
+    def release(self) -> None:
+        waiter, self._holder = self._holder, None
+        if waiter is not None:
+            state = self._clients[waiter.client]
+            cost, self._charged = self._charged, 0.0
+            state.finish += (cost - state.estimate) / state.weight
+            state.estimate = cost
+            state.used += cost
+            state.slots += 1
+            if state.budget:
+                self._refill(state)
+                state.tokens -= cost
+        self._dispatch()
+
+    @contextlib.asynccontextmanager
+    async def slot(self, name: str | None = None):
+        await self.acquire(name)
+        try:
+            yield
+        finally:
+            self.release()
+
+    def stats(self) -> dict[str, dict]:
+        total = sum(state.used for state in self._clients.values()) or 1.0
+        waiting = {}
+        for waiter in self._queue:
+            waiting[waiter.client] = waiting.get(waiter.client, 0) + 1
+        return {
+            name: {
+                "weight": state.weight,
+                "budget": state.budget,
+                "wire_time": state.used,
+                "share": state.used / total,
+                "slots": state.slots,
+                "waiting": waiting.get(name, 0),
+            }
+            for name, state in self._clients.items()
+        }
+
+    def _client(self, name: str) -> _Client:
+        state = self._clients.get(name)
+        if state is None:
+            state = self._clients[name] = _Client(stamp=self._clock())
+        return state
+
+    def _refill(self, state: _Client) -> None:
+        now = self._clock()
+        state.tokens = min(state.budget * BUDGET_WINDOW, state.tokens + (now - state.stamp) * state.budget)
+        state.stamp = now
+
+    def _dispatch(self) -> None:
+        if self._holder is not None or not self._queue:
+            return
+        if self._timer is not None:
+            self._timer.cancel()
+            self._timer = None
+        best, wake = None, None
+        for waiter in self._queue:
+            if waiter.future.done():
+                continue
+            state = self._clients[waiter.client]
+            if state.budget:
+                self._refill(state)
+                if state.tokens < 0:
+                    delay = -state.tokens / state.budget
+                    wake = delay if wake is None else min(wake, delay)
+                    continue
+            if best is None or waiter < best:
+                best = waiter
+        if best is not None:
+            self._queue.remove(best)
+            self._holder = best
+            self._virtual = max(self._virtual, best.start)
+            best.future.set_result(None)
+        elif wake is not None:
+            self._timer = asyncio.get_running_loop().call_later(wake, self._dispatch)
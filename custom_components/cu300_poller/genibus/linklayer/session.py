@@ -0,0 +1,243 @@
+"""Record and replay GENIBus bus sessions.
+
+A session file is JSON-lines: one header line followed by one line per
+transaction, e.g.
+
+    {"version": 1, "created": 1700000000.0}
+    {"t": 0.0, "da": 32, "req": "27...", "rep": "24...", "rtt": 0.0123, "error": null}
+    {"t": 30.01, "da": 32, "req": "27...", "rep": null, "rtt": 5.0, "error": "timeout"}
+
+"t" is the offset of the request from the start of the recording, "rtt" the
+time from the end of the write until the reply (or the error) was seen.
+Every connect appends a new segment with its own header line, so a
+reconnect never loses what was recorded before it.
+Long recordings can be compacted into archives (see archive.py), which are
+loaded and replayed the same way.
+"""
+import asyncio
+import json
+import logging
+import queue
+import threading
+import time
+from collections import defaultdict, deque
+
+from .. import gbdefs
+from .archive import ArchiveReader, is_archive
+from .connection import Connection
+from ..exceptions import ProtocolError, ConnectionError as CU300ConnectionError
+
+_LOGGER = logging.getLogger(__name__)
+
+SESSION_VERSION = 1
+
+ERROR_TIMEOUT   = "timeout"
+ERROR_FRAME     = "frame"
+
+
+class SessionRecorder:
+    """Append a segment of transactions to a session file.
+
+    The file is written by a thread of its own, so recording never blocks
+    the event loop the bus is polled from.
+    """
+
+    def __init__(self, path: str) -> None:
+        self._path = path
+        self._start = time.monotonic()
+        self._queue = queue.SimpleQueue()
+        self._queue.put(json.dumps({"version": SESSION_VERSION, "created": time.time()}))
+        self._thread = threading.Thread(target=self._run, name="genibus-session-recorder", daemon=True)
+        self._thread.start()
+
+    def record(self, started, request, reply, rtt, error=None) -> None:
+        entry = {
+            "t": round(started - self._start, 6),
+            "da": request[gbdefs.DESTINATION_ADRESS] if len(request) > gbdefs.DESTINATION_ADRESS else None,
+            "req": bytes(request).hex(),
+            "rep": bytes(reply).hex() if reply is not None else None,
+            "rtt": round(rtt, 6),
+            "error": error,
+        }
+        if self._thread:
+            self._queue.put(json.dumps(entry))
+
+    def close(self) -> None:
+        """Write out what is queued and close the file; blocks until done."""
+        if self._thread:
+            self._queue.put(None)
+            self._thread.join()
+            self._thread = None
+
+    def _run(self) -> None:
+        try:
+            with open(self._path, "a", encoding="utf-8") as fp:
+                while (line := self._queue.get()) is not None:
+                    fp.write(line + "\n")
+                    if self._queue.empty():
+                        fp.flush()
+        except OSError as err:
+            _LOGGER.error("Recording to %s stopped: %s", self._path, err)
+            while self._queue.get() is not None:
+                pass
+
+
+def read_segments(fp):
+    """(created, entry) of every transaction in a session file, segment by segment."""
+    created = None
+    for line in fp:
+        if not line.strip():
+            continue
+        entry = json.loads(line)
+        if "version" in entry:
+            if entry["version"] != SESSION_VERSION:
+                raise ValueError(f"Unsupported session version: {entry['version']}")
+            created = entry.get("created", 0.0)
+        elif created is None:
+            raise ValueError("Session file without a header")
+        else:
+            yield created, entry
+
+
+class RecordingConnection(Connection):
+    """Transparent wrapper that records every request/reply pair of a real connection."""
+
+    def __init__(self, connection: Connection, path: str) -> None:
+        super().__init__()
+        self._connection = connection
+        self._path = path
+        self._recorder = None
+        self._pending = None
+
+    async def connect(self):
+        await self._connection.connect()
+        self._recorder = SessionRecorder(self._path)
+
+    async def disconnect(self):
+        await self._connection.disconnect()
+        if self._recorder:
+            recorder, self._recorder = self._recorder, None
+            await asyncio.get_running_loop().run_in_executor(None, recorder.close)
+
+    async def write(self, data):
+        await self._connection.write(data)
+        self._pending = (time.monotonic(), bytes(data))
+
+    async def read(self, size=1):
+        return await self._connection.read(size)
+
+    async def read_frame(self, resync: bool = False) -> bytearray:
+        started, request = self._pending or (time.monotonic(), b"")
+        self._pending = None
+        try:
+            frame = await self._connection.read_frame(resync)
+        except asyncio.CancelledError:
+            self._record(started, request, None, ERROR_TIMEOUT)
+            raise
+        except ProtocolError:
+            self._record(started, request, None, ERROR_FRAME)
+            raise
+        self._record(started, request, frame)
+        return frame
+
+    def _record(self, started, request, reply, error=None):
+        if self._recorder:
+            self._recorder.record(started, request, reply, time.monotonic() - started, error)
+
+
+def load_session(path: str) -> list[dict]:
+    """Load the transactions of a session file or archive."""
+    if is_archive(path):
+        return list(ArchiveReader(path).transactions())
+    transactions, first = [], None
+    with open(path, encoding="utf-8") as fp:
+        for created, entry in read_segments(fp):
+            if first is None:
+                first = created
+            # Later segments continue the time line of the first.
+            entry["t"] = round(entry["t"] + created - first, 6)
+            transactions.append(entry)
+    return transactions
+
+
+def summarize_session(transactions: list[dict]) -> dict[int, dict]:
+    """Per-slave turnaround and error statistics of a session."""
+    result = {}
+    for entry in transactions:
+        stats = result.setdefault(entry["da"], {"count": 0, "errors": defaultdict(int), "rtt_min": None, "rtt_max": None, "rtt_sum": 0.0})
+        stats["count"] += 1
+        if entry["error"]:
+            stats["errors"][entry["error"]] += 1
+            continue
+        rtt = entry["rtt"]
+        stats["rtt_sum"] += rtt
+        stats["rtt_min"] = rtt if stats["rtt_min"] is None else min(stats["rtt_min"], rtt)
+        stats["rtt_max"] = rtt if stats["rtt_max"] is None else max(stats["rtt_max"], rtt)
+    for stats in result.values():
+        replies = stats["count"] - sum(stats["errors"].values())
+        stats["rtt_mean"] = stats["rtt_sum"] / replies if replies else None
+        stats["errors"] = dict(stats["errors"])
+    return result
+
+
+class ReplayConnection(Connection):
+    """Stand-in for a bus that answers from a recorded session.
+
+    Requests are matched byte-for-byte against the recording; identical
+    requests are answered with their recorded outcomes in order (cycling once
+    exhausted), after the recorded turnaround time divided by `speed`.
+    Replies that failed the CRC check are replayed byte-for-byte, recorded
+    timeouts and framing errors produce no reply at all.
+    """
+
+    def __init__(self, path: str, speed: float = 1.0) -> None:
+        super().__init__()
+        self._path = path
+        self._speed = speed
+        self._outcomes = {}
+        self._cursor = {}
+        self._tasks = deque()
+
+    async def connect(self):
+        try:
+            transactions = load_session(self._path)
+        except (OSError, ValueError) as err:
+            raise CU300ConnectionError(f"Cannot load session {self._path}: {err}") from err
+        self._outcomes = defaultdict(list)
+        for entry in transactions:
+            self._outcomes[entry["req"]].append(entry)
+        self._cursor = defaultdict(int)
+        self._reader = asyncio.StreamReader()
+        self._writer = None
+        _LOGGER.info("Replaying %d transactions from %s", len(transactions), self._path)
+
+    async def disconnect(self):
+        while self._tasks:
+            self._tasks.popleft().cancel()
+        self._reader = None
+
+    async def write(self, data):
+        if self._reader is None:
+            raise CU300ConnectionError("Replay session not connected")
+        key = bytes(data).hex()
+        outcomes = self._outcomes.get(key)
+        if not outcomes:
+            _LOGGER.debug("No recorded reply for %s", key)
+            return
+        entry = outcomes[self._cursor[key] % len(outcomes)]
+        self._cursor[key] += 1
+        if entry["rep"] is None:
+            return
+        while self._tasks and self._tasks[0].done():
+            self._tasks.popleft()
+        self._tasks.append(asyncio.ensure_future(self._reply(bytes.fromhex(entry["rep"]), entry["rtt"] / self._speed)))
+
+    async def _reply(self, data, delay):
+        await asyncio.sleep(delay)
+        if self._reader is not None:
+            self._reader.feed_data(data)
+
+    async def read(self, size=1):
+        if self._reader is None:
+            return bytearray()
+        return await self._reader.read(size)
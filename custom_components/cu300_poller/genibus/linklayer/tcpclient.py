@@ -1,9 +1,15 @@
 import logging
 import asyncio
+import socket
 from .connection import Connection
 
 _logger = logging.getLogger(__name__)
 
+# Idle time / probe interval / probe count for TCP keepalive towards serial-to-Ethernet converters.
+KEEPALIVE_IDLE      = 30
+KEEPALIVE_INTERVAL  = 10
+KEEPALIVE_COUNT     = 3
+
 class TcpClient(Connection):
     def __init__(self, host, port):
         super().__init__()
@@ -18,6 +24,21 @@ class TcpClient(Connection):
         except Exception as e:
             _logger.error(f"Failed to connect to {self._host}:{self._port}: {e}")
             raise
+        self._configureSocket(self._writer.get_extra_info('socket'))
+
+    def _configureSocket(self, sock):
+        """GENIBus telegrams are tiny request/reply pairs, Nagle would only hold them back."""
+        if sock is None:
+            return
+        try:
+            sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_KEEPALIVE, 1)
+            if hasattr(socket, 'TCP_KEEPIDLE'):
+                sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_KEEPIDLE, KEEPALIVE_IDLE)
+                sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_KEEPINTVL, KEEPALIVE_INTERVAL)
+                sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_KEEPCNT, KEEPALIVE_COUNT)
+        except OSError as e:
+            _logger.warning(f"Failed to set socket options for {self._host}:{self._port}: {e}")
 
     async def disconnect(self):
         if self._writer:
@@ -34,4 +55,4 @@ class TcpClient(Connection):
     async def read(self, size=1):
         if self._reader:
             return await self._reader.read(size)
-        return bytearray()
\ No newline at end of file
+        return bytearray()
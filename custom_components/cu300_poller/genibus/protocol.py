@@ -1,25 +1,70 @@
 """High-level protocol handler for CU300 using GENIBus."""
 import asyncio
+import contextlib
 import logging
+import time
 from typing import Any
 
 from .linklayer.serialport import SerialPort
 from .linklayer.tcpclient import TcpClient
+from .linklayer.session import RecordingConnection, ReplayConnection
+from .linklayer.retry import RetryPolicy
+from .linklayer.fairshare import BusScheduler
 from .apdu import (
     APDU,
+    compositeLayout,
+    DEFAULT_BUF_LEN,
+    decodeEmbeddedReply,
+    decodeInfoReply,
+    decodeReply,
     Header,
+    createCompoundPDU,
     createConnectRequestPDU,
-    createGetValuesPDU,
-    createSetCommandsPDU,
-    createSetValuesPDU,
+    createEmbeddedPDUs,
+    createGetMeasuredDataAPDU,
+    createGetPDUs,
+    createInfoPDUs,
+    createSetPDUs,
+    createSetCommandsAPDU,
+    createSetReferencesAPDU,
+    infoScale,
+    isKnown,
+    splitAPDUs,
 )
 from . import gbdefs
+from .codec import ReplyCodec
+from .composite import CompositeDecoder
+from .datamanager.alarms import alarmDatapoints
 from .utils import crc
-from .devices.db import DeviceDB
-from .exceptions import ProtocolError, ConnectionError as CU300ConnectionError
+from .utils.trace import tracer
+from .devices.db import DeviceDB, DEFAULT_MODEL
+from .exceptions import CRCError, ProtocolError, ConnectionError as CU300ConnectionError
 
 _LOGGER = logging.getLogger(__name__)
 
+# Class 2 datapoint name -> key of the value in the data handed to Home Assistant.
+DATA_KEYS = {
+    'h': 'head',
+    'q': 'flow',
+    'p': 'power',
+    'speed': 'speed',
+    'act_mode1': 'act_mode1',
+    'alarm_code': 'alarm_code',
+    'ref_act': 'reference',
+}
+
+# Prefix of the values of the unit behind the CU300 (see poll_embedded()).
+EMBEDDED_PREFIX = 'embedded_'
+
+# What the commands SET: class 3 commands and the class 5 reference, none of them in the static tier.
+COMMANDS_START  = ['REMOTE', 'START']
+COMMANDS_STOP   = ['STOP']
+REFERENCE_SET   = 'ref_rem'
+
+# Datapoints read back in the same telegram as a command, to confirm it took effect.
+READBACK_PUMP       = ['act_mode1']
+READBACK_REFERENCE  = ['ref_act']
+
 
 class CU300Protocol:
     """High-level protocol handler for CU300."""
@@ -31,16 +76,37 @@ class CU300Protocol:
         port: str | None = None,
         device_addr: int = 0x20,
         source_addr: int = 0x04,
+        record_path: str | None = None,
+        retry_policy: RetryPolicy | None = None,
+        baudrate: int = 9600,
     ) -> None:
-        """Initialize protocol handler."""
+        """Initialize protocol handler.
+
+        With connection_type "replay", `port` names a session file recorded
+        earlier via `record_path`, and the bus is simulated from it.
+        `baudrate` is the line speed used to account bus time to clients
+        (see `scheduler`); the serial port is opened with it as well.
+        """
         self._connection_type = connection_type
         self._host = host
         self._port = port
         self._device_addr = device_addr
         self._source_addr = source_addr
+        self._record_path = record_path
+        self.retry_policy = retry_policy or RetryPolicy()
         self._connection = None
-        self._lock = asyncio.Lock()
+        self._baudrate = baudrate
+        self.scheduler = BusScheduler(baudrate)
         self._device_db = DeviceDB()
+        self._buf_len = DEFAULT_BUF_LEN
+        self._datapoints = frozenset()
+        self._plans = {}
+        self._composites = CompositeDecoder()
+        self._embedded_plans = {}
+        self._alarm_plans = {}
+        self._catalog_version = None
+        self.model = DEFAULT_MODEL
+        self.identity = {}
         
         _LOGGER.debug(
             "Initialized CU300Protocol: type=%s, host=%s, port=%s",
@@ -59,10 +125,17 @@ class CU300Protocol:
                 if not self._host:
                     raise CU300ConnectionError("Host required for TCP connection")
                 self._connection = TcpClient(self._host, self._port)
+            elif self._connection_type == "replay":
+                if not self._port:
+                    raise CU300ConnectionError("Session file required for replay")
+                self._connection = ReplayConnection(self._port)
             else:
                 if not self._port:
                     raise CU300ConnectionError("Port required for serial connection")
-                self._connection = SerialPort(self._port)
+                self._connection = SerialPort(self._port, baudrate=self._baudrate)
+
+            if self._record_path and self._connection_type != "replay":
+                self._connection = RecordingConnection(self._connection, self._record_path)
 
             # Establish connection
             await asyncio.wait_for(self._connection.connect(), timeout=10)
@@ -75,6 +148,8 @@ class CU300Protocol:
             if not response:
                 raise ProtocolError("No response to connect request")
 
+            self.adopt_identity(decodeReply(connect_pdu, response))
+
             _LOGGER.info("Successfully connected to CU300")
 
         except asyncio.TimeoutError as err:
@@ -87,6 +162,27 @@ class CU300Protocol:
                 self._connection = None
             raise CU300ConnectionError(f"Connection failed: {err}") from err
 
+    def adopt_identity(self, identity: dict) -> None:
+        """Size the telegrams and select the device model from the unit's connect reply.
+
+        Also used with the identity of the last run, so a warm start builds the
+        right entities before the unit answered.
+        """
+        self.identity = identity
+        buf_len = identity.get('buf_len') or DEFAULT_BUF_LEN
+        if buf_len != self._buf_len:
+            self._buf_len = buf_len
+            self._drop_plans()
+        model = self._device_db.resolveModel(identity.get('unit_family'), identity.get('unit_type'))
+        if model != self.model:
+            _LOGGER.info(
+                "Unit family %s, type %s: using the '%s' device model",
+                identity.get('unit_family'),
+                identity.get('unit_type'),
+                model,
+            )
+            self.model = model
+
     async def disconnect(self) -> None:
         """Disconnect from the device."""
         _LOGGER.debug("Disconnecting from device")
@@ -105,33 +201,91 @@ class CU300Protocol:
         await asyncio.sleep(1)  # Brief delay before reconnecting
         await self.connect()
 
+    @contextlib.asynccontextmanager
+    async def _bus(self):
+        """Exclusive access to the bus, granted in weighted fair order of the clients' bus time.
+
+        The time spent waiting shows up as its own span.
+        """
+        with tracer.span("bus_wait"):
+            await self.scheduler.acquire()
+        try:
+            yield
+        finally:
+            self.scheduler.release()
+
+    def catalog(self) -> list[tuple]:
+        """All datapoints of the device model as (model, name, class, id, access, note)."""
+        return self._device_db.dataitems(self.model)
+
+    def set_datapoints(self, datapoints) -> None:
+        """Select the datapoints polled on top of DATA_KEYS; the request plan is rebuilt lazily."""
+        datapoints = frozenset(datapoints)
+        if datapoints != self._datapoints:
+            _LOGGER.debug("Polled datapoints changed: %s", sorted(datapoints))
+            self._datapoints = datapoints
+            self._plans.clear()
+
+    def _drop_plans(self) -> None:
+        self._plans.clear()
+        self._alarm_plans.clear()
+        self._embedded_plans.clear()
+        self._catalog_version = self._device_db.version
+
+    def _check_catalog(self) -> None:
+        """Recompile the plans lazily, on their next use, once a new catalog version was published."""
+        if self._catalog_version != self._device_db.version:
+            _LOGGER.debug("Device catalog version %s published, recompiling request plans", self._device_db.version)
+            self._drop_plans()
+
+    def _request_plan(self) -> tuple[list[tuple[bytearray, ReplyCodec]], dict]:
+        """Telegrams for one poll cycle, their reply decoders and composite layouts.
+
+        Compiled once per model, datapoint selection and catalog version; units of
+        different models keep their own plans, so polling does no catalog lookups.
+        """
+        self._check_catalog()
+        plan = self._plans.get(self.model)
+        if plan is None:
+            header = Header(
+                gbdefs.FrameType.SD_DATA_REQUEST,
+                self._device_addr,
+                self._source_addr,
+            )
+            names = list(DATA_KEYS) + sorted(self._datapoints.difference(DATA_KEYS))
+            # A datapoint of another model (e.g. a selection carried over) must not fail the whole poll.
+            unknown = [name for name in names if not isKnown(name, self.model)]
+            if unknown:
+                _LOGGER.warning("Not polled, unknown to the '%s' device model: %s", self.model, ", ".join(unknown))
+                names = [name for name in names if name not in unknown]
+            plan = self._plans[self.model] = (
+                [
+                    (pdu, ReplyCodec(pdu, self.model))
+                    for pdu in createGetPDUs(header, names, self._buf_len, self.model)
+                ],
+                {
+                    name: layout for name, layout in ((name, compositeLayout(name, self.model)) for name in names) if layout
+                },
+            )
+        return plan
+
     async def poll_data(self) -> dict[str, Any]:
         """Poll measured data from the device."""
-        async with self._lock:
+        plan, layouts = self._request_plan()
+        async with self._bus():
             try:
-                # Create data request PDU using APDU helpers
-                header = Header(
-                    gbdefs.FrameType.SD_DATA_REQUEST,
-                    self._device_addr,
-                    self._source_addr,
-                )
-                
-                # Request key measurements
-                measurements = ['h', 'q', 'speed', 'act_mode1', 'alarm_code']
-                
-                pdu = createGetValuesPDU(
-                    klass=gbdefs.APDUClass.MEASURED_DATA,
-                    header=header,
-                    measurements=measurements,
-                )
-                
-                response = await self._send_and_receive(pdu)
-                
-                if not response:
-                    raise ProtocolError("No response received")
+                values = {}
+                for pdu, codec in plan:
+                    response = await self._send_and_receive(pdu)
+                    
+                    if not response:
+                        raise ProtocolError("No response received")
+
+                    # Parse response
+                    values.update(self._parse_response(pdu, response, codec))
+
+                data = self._to_data(self._composites.decode(values, layouts))
 
-                # Parse response
-                data = self._parse_response(response)
                 _LOGGER.debug("Parsed data: %s", data)
                 
                 return data
@@ -143,9 +297,111 @@ class CU300Protocol:
                 _LOGGER.error("Error polling data: %s", err)
                 raise
 
-    async def start_pump(self) -> None:
+    async def read_datapoints(self, names) -> dict[str, Any]:
+        """One-off read of `names` (raw names), e.g. for the static tier; not part of the poll plan."""
+        header = Header(
+            gbdefs.FrameType.SD_DATA_REQUEST,
+            self._device_addr,
+            self._source_addr,
+        )
+        async with self._bus():
+            values = {}
+            for pdu in createGetPDUs(header, list(names), self._buf_len, self.model):
+                response = await self._send_and_receive(pdu)
+                values.update(self._parse_response(pdu, response))
+            return values
+
+    async def read_scales(self, names) -> dict[str, tuple]:
+        """Scaling of `names` (raw names) from INFO requests: name -> (factor, offset, unit).
+
+        Datapoints the unit reports no scaling for are left out.
+        """
+        header = Header(
+            gbdefs.FrameType.SD_DATA_REQUEST,
+            self._device_addr,
+            self._source_addr,
+        )
+        units = self._device_db.units()
+        scales = {}
+        async with self._bus():
+            for pdu in createInfoPDUs(header, list(names), self._buf_len, self.model):
+                response = await self._send_and_receive(pdu)
+                for name, info in decodeInfoReply(pdu, response, self.model).items():
+                    scale = infoScale(info, units)
+                    if scale is not None:
+                        scales[name] = scale
+        return scales
+
+    async def write_datapoints(self, values: dict[str, int]) -> None:
+        """Write class 4/5 `values` (raw names) in as few multi-item SET telegrams as the buffer allows.
+
+        Raises ProtocolError if the unit rejects any of the APDUs.
+        """
+        header = Header(
+            gbdefs.FrameType.SD_DATA_REQUEST,
+            self._device_addr,
+            self._source_addr,
+        )
+        rejected = []
+        async with self._bus():
+            for pdu in createSetPDUs(header, values, self._buf_len, self.model):
+                response = await self._send_and_receive(pdu)
+                for klass, ack, _ in splitAPDUs(response):
+                    if ack != gbdefs.Acknowledge.OK:
+                        rejected.append(f"class {klass}: {gbdefs.Acknowledge(ack).name}")
+        if rejected:
+            raise ProtocolError(f"SET rejected ({', '.join(rejected)})")
+
+    async def poll_alarm_log(self) -> dict[str, Any]:
+        """Read the alarm log and alarm slots (raw names); only needed when an alarm indicator changed."""
+        self._check_catalog()
+        plan = self._alarm_plans.get(self.model)
+        if plan is None:
+            header = Header(
+                gbdefs.FrameType.SD_DATA_REQUEST,
+                self._device_addr,
+                self._source_addr,
+            )
+            plan = self._alarm_plans[self.model] = [
+                (pdu, ReplyCodec(pdu, self.model))
+                for pdu in createGetPDUs(header, alarmDatapoints(self.model), self._buf_len, self.model)
+            ]
+        async with self._bus():
+            values = {}
+            for pdu, codec in plan:
+                response = await self._send_and_receive(pdu)
+                values.update(self._parse_response(pdu, response, codec))
+            return values
+
+    async def poll_embedded(self, datapoints, model: str) -> dict[str, Any]:
+        """Read datapoints of the unit behind the CU300 (e.g. the SP pump) through class 9 tunnelling.
+
+        All datapoints travel in as few outer telegrams as the buffer allows;
+        `model` is the catalog model of the inner unit.
+        """
+        self._check_catalog()
+        key = (tuple(datapoints), model)
+        plan = self._embedded_plans.get(key)
+        if plan is None:
+            header = Header(
+                gbdefs.FrameType.SD_DATA_REQUEST,
+                self._device_addr,
+                self._source_addr,
+            )
+            plan = self._embedded_plans[key] = createEmbeddedPDUs(header, datapoints, self._buf_len, model)
+
+        async with self._bus():
+            data = {}
+            for pdu in plan:
+                response = await self._send_and_receive(pdu)
+                if not response:
+                    raise ProtocolError("No response to embedded request")
+                data.update(decodeEmbeddedReply(pdu, response, model))
+            return data
+
+    async def start_pump(self) -> dict[str, Any]:
         """Start the pump."""
-        async with self._lock:
+        async with self._bus():
             try:
                 header = Header(
                     gbdefs.FrameType.SD_DATA_REQUEST,
@@ -153,22 +409,27 @@ class CU300Protocol:
                     self._source_addr,
                 )
                 
-                pdu = createSetCommandsPDU(header, commands=['REMOTE', 'START'])
+                pdu = createCompoundPDU(header, [
+                    createSetCommandsAPDU(COMMANDS_START, self.model),
+                    createGetMeasuredDataAPDU(gbdefs.APDUClass.MEASURED_DATA, READBACK_PUMP, self.model),
+                ])
                 
                 response = await self._send_and_receive(pdu)
                 
                 if not response:
                     raise ProtocolError("No response to start command")
+                self._check_ack(response)
                 
                 _LOGGER.info("Pump started successfully")
+                return self._to_data(self._parse_response(pdu, response))
 
             except Exception as err:
                 _LOGGER.error("Failed to start pump: %s", err)
                 raise ProtocolError(f"Failed to start pump: {err}") from err
 
-    async def stop_pump(self) -> None:
+    async def stop_pump(self) -> dict[str, Any]:
         """Stop the pump."""
-        async with self._lock:
+        async with self._bus():
             try:
                 header = Header(
                     gbdefs.FrameType.SD_DATA_REQUEST,
@@ -176,25 +437,30 @@ class CU300Protocol:
                     self._source_addr,
                 )
                 
-                pdu = createSetCommandsPDU(header, commands=['STOP'])
+                pdu = createCompoundPDU(header, [
+                    createSetCommandsAPDU(COMMANDS_STOP, self.model),
+                    createGetMeasuredDataAPDU(gbdefs.APDUClass.MEASURED_DATA, READBACK_PUMP, self.model),
+                ])
                 
                 response = await self._send_and_receive(pdu)
                 
                 if not response:
                     raise ProtocolError("No response to stop command")
+                self._check_ack(response)
                 
                 _LOGGER.info("Pump stopped successfully")
+                return self._to_data(self._parse_response(pdu, response))
 
             except Exception as err:
                 _LOGGER.error("Failed to stop pump: %s", err)
                 raise ProtocolError(f"Failed to stop pump: {err}") from err
 
-    async def set_reference(self, value: int) -> None:
+    async def set_reference(self, value: int) -> dict[str, Any]:
         """Set reference value (0-100%)."""
         if not 0 <= value <= 100:
             raise ValueError("Reference value must be between 0 and 100")
 
-        async with self._lock:
+        async with self._bus():
             try:
                 header = Header(
                     gbdefs.FrameType.SD_DATA_REQUEST,
@@ -202,22 +468,33 @@ class CU300Protocol:
                     self._source_addr,
                 )
                 
-                pdu = createSetValuesPDU(
-                    header,
-                    references=[('ref', value)],
-                )
+                pdu = createCompoundPDU(header, [
+                    createSetReferencesAPDU([(REFERENCE_SET, value)], self.model),
+                    createGetMeasuredDataAPDU(gbdefs.APDUClass.MEASURED_DATA, READBACK_REFERENCE, self.model),
+                ])
                 
                 response = await self._send_and_receive(pdu)
                 
                 if not response:
                     raise ProtocolError("No response to set reference")
+                self._check_ack(response)
                 
                 _LOGGER.info("Reference set to %s%%", value)
+                return self._to_data(self._parse_response(pdu, response))
 
             except Exception as err:
                 _LOGGER.error("Failed to set reference: %s", err)
                 raise ProtocolError(f"Failed to set reference: {err}") from err
 
+    @staticmethod
+    def _check_ack(response: bytearray) -> None:
+        """Raise ProtocolError unless the unit acknowledged the first APDU of `response` (the SET of a command)."""
+        for klass, ack, _ in splitAPDUs(response):
+            if ack != gbdefs.Acknowledge.OK:
+                raise ProtocolError(f"SET rejected (class {klass}: {gbdefs.Acknowledge(ack).name})")
+            return
+        raise ProtocolError("Empty reply")
+
     async def _send_and_receive(self, pdu: bytearray) -> bytearray:
         """Send PDU and receive response."""
         if not self._connection:
@@ -229,86 +506,93 @@ class CU300Protocol:
 
         _LOGGER.debug("Sending PDU: %s", pdu.hex())
         
+        slave = pdu[gbdefs.DESTINATION_ADRESS]
+        with tracer.span("send_and_receive", da=slave):
+            attempt = 0
+            while True:
+                try:
+                    return await self._transfer(pdu, resync=attempt > 0)
+                except CRCError:
+                    delay = self.retry_policy.delay(slave, attempt)
+                    if delay is None:
+                        raise
+                    attempt += 1
+                    _LOGGER.debug("CRC error from 0x%02x, retry %d in %.3fs", slave, attempt, delay)
+                    tracer.instant("crc_retry", attempt=attempt)
+                    await asyncio.sleep(delay)
+                    # The rest of the bad reply (or a late one) must not be taken for the next reply.
+                    discarded = await self._connection.discard_input()
+                    if discarded:
+                        _LOGGER.debug("Discarded %d stale bytes from 0x%02x", discarded, slave)
+
+    async def _transfer(self, pdu: bytearray, resync: bool = False) -> bytearray:
+        """One request/reply exchange on the wire, charged to the client holding the bus.
+
+        With `resync`, noise in front of the reply is skipped (see Connection.read_frame()).
+        """
+        started = time.monotonic()
         try:
-            await self._connection.write(pdu)
-            response = await asyncio.wait_for(
-                self._read_frame(),
-                timeout=5,
-            )
+            with tracer.span("write"):
+                await self._connection.write(pdu)
+            tracer.instant("tx", length=len(pdu))
+            with tracer.span("turnaround"):
+                response = await asyncio.wait_for(
+                    self._read_frame(resync),
+                    timeout=5,
+                )
+            tracer.instant("rx", length=len(response))
             _LOGGER.debug("Received response: %s", response.hex())
+            self.scheduler.charge(len(pdu) + len(response))
             return response
 
         except asyncio.TimeoutError as err:
             _LOGGER.error("Timeout waiting for response")
+            self.scheduler.charge(len(pdu), time.monotonic() - started)
             raise ProtocolError("Response timeout") from err
+        except CRCError:
+            self.scheduler.charge(len(pdu), time.monotonic() - started)
+            raise
 
-    async def _read_frame(self) -> bytearray:
+    async def _read_frame(self, resync: bool = False) -> bytearray:
         """Read a complete GENIBus frame."""
-        if not self._connection or not self._connection._reader:
+        if not self._connection:
             raise CU300ConnectionError("No active connection")
 
-        # Read start delimiter
-        start = await self._connection._reader.read(1)
-        if not start:
-            raise ProtocolError("No data received")
-
-        start_byte = start[0]
-        if start_byte not in [
-            gbdefs.FrameType.SD_DATA_REQUEST,
-            gbdefs.FrameType.SD_DATA_REPLY,
-            gbdefs.FrameType.SD_DATA_MESSAGE,
-        ]:
-            raise ProtocolError(f"Invalid start delimiter: 0x{start_byte:02x}")
-
-        # Read length byte
-        length_data = await self._connection._reader.read(1)
-        if not length_data:
-            raise ProtocolError("Failed to read length byte")
-        
-        length = length_data[0]
-        
-        if length > gbdefs.MAX_PDU_LEN:
-            raise ProtocolError(f"Invalid frame length: {length}")
-
-        # Read remaining data (length + 2 for CRC)
-        remaining_length = length + 2
-        remaining = await self._connection._reader.read(remaining_length)
-        
-        if len(remaining) != remaining_length:
-            raise ProtocolError(
-                f"Incomplete frame: expected {remaining_length}, got {len(remaining)}"
-            )
-
-        # Assemble complete frame
-        frame = start + length_data + remaining
+        frame = await self._connection.read_frame(resync)
 
         # Verify CRC
         if not crc.check_tel(frame, silent=True):
-            raise ProtocolError("CRC check failed")
+            raise CRCError("CRC check failed")
 
         return frame
 
-    def _parse_response(self, response: bytearray) -> dict[str, Any]:
-        """Parse response frame into data dictionary."""
+    def _parse_response(self, request: bytearray, response: bytearray, codec: ReplyCodec | None = None) -> dict[str, Any]:
+        """Parse response frame into a dictionary of datapoint values.
+
+        With the precompiled `codec` of a plan telegram the reply is unpacked
+        directly; its CRC was already checked by _read_frame().
+        """
         try:
-            apdu = APDU.from_bytes(response)
+            if codec is not None:
+                return codec.decode(response)
+
+            apdu = APDU.from_bytes(response, request, self.model)
             
             if not apdu:
                 raise ProtocolError("Failed to parse APDU")
 
-            # Extract values with proper naming
-            data = {
-                'head': apdu.get_value('h'),
-                'flow': apdu.get_value('q'),
-                'speed': apdu.get_value('speed'),
-                'power': apdu.get_value('p'),
-                'act_mode1': apdu.get_value('act_mode1'),
-                'alarm_code': apdu.get_value('alarm_code'),
-            }
-
-            # Filter out None values
-            return {k: v for k, v in data.items() if v is not None}
+            return {name: value for name, value in apdu.items() if value is not None}
 
         except Exception as err:
             _LOGGER.error("Error parsing response: %s", err)
             raise ProtocolError(f"Failed to parse response: {err}") from err
+
+    def _to_data(self, values: dict[str, Any]) -> dict[str, Any]:
+        """Name values the way Home Assistant sees them; catalog datapoints keep their own name."""
+        data = {}
+        for name, value in values.items():
+            if name in DATA_KEYS:
+                data[DATA_KEYS[name]] = value
+            if name in self._datapoints:
+                data[name] = value
+        return data
@@ -0,0 +1,117 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+##
+## Desired-state reconciliation of configuration parameters and references.
+##
+## A profile maps class 4/5 datapoints to the values a unit should have. The
+## reconciler reads what is readable in packed telegrams, diffs, and writes
+## only the differing items in multi-item SETs; the written parameters are
+## read back to verify them. Class 5 references are write-only on the units
+## of the catalog, so for those the value this reconciler last wrote stands in
+## for the current one (unknown until then, hence written once).
+##
+
+import asyncio
+from collections import namedtuple
+
+from . import gbdefs as defs
+from .apdu import db, SETTABLE_CLASSES
+
+Change = namedtuple('Change', 'name current desired')
+
+ReconcileResult = namedtuple('ReconcileResult', 'changes failed')
+
+# Per-unit bus addresses: one profile for the whole fleet would put every unit
+# on the same address, and the protocol would keep talking to the old one.
+ADDRESSING_PARAMETERS = ('unit_addr', 'group_addr')
+
+
+def checkProfile(profile, model):
+    """Raise before any bus traffic if the profile can't be applied to `model`."""
+    for name, value in profile.items():
+        item = db.dataitemByClassAndName(model, name)
+        if not item:
+            raise KeyError(name)
+        if name in ADDRESSING_PARAMETERS:
+            raise ValueError("Addressing parameter '{0}' can't be part of a profile".format(name))
+        if item.klass not in SETTABLE_CLASSES or item.access == defs.Access.RO:
+            raise ValueError("Datapoint '{0}' is not writable".format(name))
+        if not isinstance(value, int) or not 0 <= value <= 0xff:
+            raise ValueError("Value {0} out of range for '{1}'".format(value, name))
+
+
+def diffProfile(profile, current):
+    """Changes needed to get from `current` to `profile`, in profile order."""
+    return [Change(name, current.get(name), value) for name, value in profile.items() if current.get(name) != value]
+
+
+class Reconciler(object):
+
+    def __init__(self, protocol):
+        self._protocol = protocol
+        self._written = {}
+
+    def _readable(self, names):
+        model = self._protocol.model
+        return [name for name in names if db.dataitemByClassAndName(model, name).access != defs.Access.WO]
+
+    async def reconcile(self, profile, dryRun = False):
+        checkProfile(profile, self._protocol.model)
+        readable = self._readable(profile)
+        current = dict((name, self._written.get(name)) for name in profile if name not in readable)
+        if readable:
+            current.update(await self._protocol.read_datapoints(readable))
+        changes = diffProfile(profile, current)
+        if dryRun or not changes:
+            return ReconcileResult(changes, [])
+
+        desired = dict((change.name, change.desired) for change in changes)
+        await self._protocol.write_datapoints(desired)
+        for name in desired:
+            if name not in readable:
+                self._written[name] = desired[name]
+
+        verify = self._readable(desired)
+        failed = []
+        if verify:
+            readback = await self._protocol.read_datapoints(verify)
+            failed = [name for name in verify if readback.get(name) != desired[name]]
+        return ReconcileResult(changes, failed)
+
+
+async def reconcileFleet(reconcilers, profile, dryRun = False):
+    """Reconcile all units in parallel; each protocol serializes access to its own bus.
+
+    Returns one ReconcileResult (or the exception raised) per reconciler.
+    """
+    return await asyncio.gather(
+        *(reconciler.reconcile(profile, dryRun) for reconciler in reconcilers),
+        return_exceptions = True
+    )
@@ -30,6 +30,8 @@ import genibus.gbdefs as defs
 import genibus.apdu as apdu
 
 import unittest
+from types import SimpleNamespace
+from unittest import mock
 
 class TestAPDUs(unittest.TestCase):
 
@@ -54,6 +56,106 @@ class TestAPDUs(unittest.TestCase):
         [0x27, 0x0a, 0x20, 0x01, 0x02, 0xc6, 0x25, 0x27, 0x22, 0x3a, 0x23, 0x98, 0x33, 0x5a]
         )
 
+    def testCompoundPDU(self):
+        self.assertEqual(self.toHex(apdu.createCompoundPDU(apdu.Header(defs.FrameType.SD_DATA_REQUEST, 0x20, 0x01),
+            [apdu.createSetCommandsAPDU(['STOP']), apdu.createGetMeasuredDataAPDU(defs.APDUClass.MEASURED_DATA, ['act_mode1'])])[:-2]),
+            [0x27, 0x08, 0x20, 0x01, 0x03, 0x81, 0x05, 0x02, 0x01, 0x51]
+        )
+
+    def testDecodeConnectReply(self):
+        reply = (0x24, 0x0e, 0x01, 0x20, 0x00, 0x02, 0x46, 0x0e, 0x04, 0x02, 0x20, 0xf7, 0x02, 0x02, 0x03, 0x01, 0x00, 0x04)
+        self.assertEqual(apdu.decodeReply(apdu.createConnectRequestPDU(0x01), reply),
+            {'buf_len': 0x46, 'unit_bus_mode': 0x0e, 'unit_addr': 0x20, 'group_addr': 0xf7, 'unit_family': 0x03, 'unit_type': 0x01}
+        )
+
+    def testPerModelIds(self):
+        header = apdu.Header(defs.FrameType.SD_DATA_REQUEST, 0x20, 0x01)
+        # 'speed' only exists in the UPE catalog.
+        self.assertEqual(self.toHex(apdu.createGetValuesPDU(2, header, measurements = ['speed'], model = 'upe')[:-2]),
+            [0x27, 0x05, 0x20, 0x01, 0x02, 0x01, 0x23]
+        )
+        with self.assertRaises(KeyError):
+            apdu.createGetValuesPDU(2, header, measurements = ['speed'])
+
+    def testIsKnown(self):
+        self.assertTrue(apdu.isKnown('i_dc', 'upe'))
+        self.assertFalse(apdu.isKnown('i_dc', 'magna'))
+        # A composite of its parts on MAGNA.
+        self.assertTrue(apdu.isKnown('speed', 'magna'))
+        self.assertFalse(apdu.isKnown('no_such_datapoint', 'upe'))
+
+    def testGetPDUsPacking(self):
+        header = apdu.Header(defs.FrameType.SD_DATA_REQUEST, 0x20, 0x01)
+        telegrams = apdu.createGetPDUs(header, ['h', 'q', 'unit_addr', 'product_name', 'serial_no'])
+        self.assertEqual([self.toHex(t[:-2]) for t in telegrams], [
+            [0x27, 0x09, 0x20, 0x01, 0x02, 0x02, 0x25, 0x27, 0x04, 0x01, 0x2e],
+            [0x27, 0x05, 0x20, 0x01, 0x07, 0x01, 0x01],
+            [0x27, 0x05, 0x20, 0x01, 0x07, 0x01, 0x09],
+        ])
+        names = [name for name in apdu.db.dataitemsByClass("magna", defs.APDUClass.MEASURED_DATA)]
+        for telegram in apdu.createGetPDUs(header, names * 2, bufLen = 70):
+            self.assertLessEqual(len(telegram), 70)
+
+    def testSetPDUs(self):
+        header = apdu.Header(defs.FrameType.SD_DATA_REQUEST, 0x20, 0x01)
+        telegrams = apdu.createSetPDUs(header, {'ref_steps': 5, 'group_addr': 0xf0, 'ref_rem': 100})
+        self.assertEqual([self.toHex(t[:-2]) for t in telegrams], [
+            [0x27, 0x0c, 0x20, 0x01, 0x04, 0x84, 0x57, 0x05, 0x2f, 0xf0, 0x05, 0x82, 0x01, 0x64],
+        ])
+        with self.assertRaises(ValueError):
+            apdu.createSetPDUs(header, {'h': 1})
+
+    def testInfo(self):
+        header = apdu.Header(defs.FrameType.SD_DATA_REQUEST, 0x20, 0x01)
+        # 'product_name' is a string (no INFO); 'h' and 'q' share one APDU.
+        telegrams = apdu.createInfoPDUs(header, ['h', 'q', 'product_name'])
+        self.assertEqual([self.toHex(t[:-2]) for t in telegrams], [[0x27, 0x06, 0x20, 0x01, 0x02, 0xc2, 0x25, 0x27]])
+        # h: scaled, 0.1 m steps (unit 24), zero 0, range 254; q: extended, m³/h (unit 23) with zero -2.
+        reply = apdu.crc.append_tel(bytearray([0x24, 0x0c, 0x01, 0x20, 0x02, 0x08, 0x82, 0x18, 0x00, 0xfe, 0x83, 0x97, 0x00, 0x02]))
+        info = apdu.decodeInfoReply(telegrams[0], reply)
+        self.assertEqual(info, {'h': defs.Info(0x82, 0x18, 0x00, 0xfe), 'q': defs.Info(0x83, 0x97, 0x0002, None)})
+        units = apdu.db.units()
+        factor, offset, unit = apdu.infoScale(info['h'], units)
+        self.assertEqual((round(factor, 6), offset, unit), (0.1, 0.0, 'm'))
+        self.assertEqual(apdu.infoScale(info['q'], units), (1.0, -2.0, 'm³/h'))
+        self.assertIsNone(apdu.infoScale(defs.Info(0x80, None, None, None), units))
+
+    def testEmbeddedPDU(self):
+        header = apdu.Header(defs.FrameType.SD_DATA_REQUEST, 0x20, 0x01)
+        telegrams = apdu.createEmbeddedPDUs(header, ['h', 'q', 'unit_addr'], model = "upe")
+        self.assertEqual(len(telegrams), 1)
+        request = telegrams[0]
+        self.assertEqual(self.toHex(request[:-2]),
+            [0x27, 0x0b, 0x20, 0x01, 0x09, 0x07, 0x02, 0x02, 0x25, 0x27, 0x04, 0x01, 0x2e]
+        )
+        reply = apdu.crc.append_tel(bytearray([0x24, 0x0b, 0x01, 0x20, 0x09, 0x07, 0x02, 0x02, 0x7a, 0x42, 0x04, 0x01, 0x20]))
+        self.assertEqual(apdu.decodeEmbeddedReply(request, reply, "upe"), {'h': 0x7a, 'q': 0x42, 'unit_addr': 0x20})
+
+    def testEmbeddedPDUBatching(self):
+        header = apdu.Header(defs.FrameType.SD_DATA_REQUEST, 0x20, 0x01)
+        names = list(apdu.db.dataitemsByClass("upe", defs.APDUClass.MEASURED_DATA))
+        telegrams = apdu.createEmbeddedPDUs(header, names, bufLen = 200, model = "upe")
+        self.assertEqual(len(telegrams), 1)
+        outer = list(apdu.splitAPDUs(telegrams[0]))
+        self.assertEqual(len(outer), 2)
+        self.assertTrue(all(klass == defs.APDUClass.EMBEDDED_PUDS and len(data) <= 0x3F for klass, _, data in outer))
+
+    def testSixteenBitReplySize(self):
+        klass = defs.APDUClass.SIXTEENBIT_MEASURED_DATA
+        items = {'m{0}'.format(ident): SimpleNamespace(klass = klass, id = ident) for ident in range(100)}
+        with mock.patch.object(apdu.db, 'dataitemByClassAndName', lambda model, name: items.get(name)), \
+                mock.patch.object(apdu, 'compositeLayout', lambda name, model: None):
+            apdus = apdu.createGetAPDUs(list(items), 62)
+        # Two reply bytes per ID have to fit the six bit length field.
+        self.assertTrue(all(2 * (len(a) - 2) <= 0x3F for _, a in apdus))
+        self.assertEqual(sum(len(a) - 2 for _, a in apdus), 100)
+        self.assertEqual(apdu.replyLength(klass, defs.Operation.GET, apdus[0][1][2:]), 2 + 2 * 31)
+        groups = apdu.packAPDUs(apdus, 64)
+        self.assertEqual(len(groups), len(apdus))
+        # Embedded PDUs are answered by the replies of what they tunnel.
+        inner = apdus[-1][1]
+        self.assertEqual(apdu.replyLength(defs.APDUClass.EMBEDDED_PUDS, defs.Operation.GET, inner), 2 + 2 + 2 * (len(inner) - 2))
+
 def main():
     unittest.main()
 
@@ -0,0 +1,76 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+import unittest
+
+from genibus.datamanager.alarms import AlarmHistory, alarmDatapoints, newLogEntries, ALARM_LOG
+
+
+def log(*codes):
+    return dict(zip(ALARM_LOG, codes))
+
+
+class TestAlarmHistory(unittest.TestCase):
+
+    def testNewLogEntries(self):
+        self.assertEqual(newLogEntries((3, 2, 1, 0, 0), (5, 4, 3, 2, 1)), [4, 5])
+        self.assertEqual(newLogEntries((3, 2, 1, 0, 0), (3, 2, 1, 0, 0)), [])
+        self.assertEqual(newLogEntries((1, 2, 3, 4, 5), (9, 8, 7, 6, 10)), [10, 6, 7, 8, 9])
+
+    def testChanged(self):
+        history = AlarmHistory()
+        indicators = {'alarm_code': 0, 'alarm_code_disp': 0, 'led_contr': 1}
+        self.assertTrue(history.changed(indicators))
+        history.update(0.0, indicators, log(3, 2, 1, 0, 0))
+        self.assertFalse(history.changed(indicators))
+        self.assertTrue(history.changed(dict(indicators, alarm_code = 57)))
+
+    def testEvents(self):
+        history = AlarmHistory()
+        indicators = {'alarm_code': 0, 'alarm_code_disp': 0, 'led_contr': 1}
+        # The first fetch is the baseline.
+        self.assertEqual(history.update(0.0, indicators, dict(log(3, 2, 1, 0, 0), stop_alarm1 = 0)), [])
+        events = history.update(10.0, dict(indicators, alarm_code = 57), dict(log(57, 3, 2, 1, 0), stop_alarm1 = 57))
+        self.assertEqual([(e.source, e.code, e.previous) for e in events], [('log', 57, None), ('stop_alarm1', 57, 0)])
+        self.assertEqual([e.seq for e in events], [1, 2])
+        self.assertEqual(history.since(1), events[1:])
+        self.assertEqual(history.update(20.0, indicators, dict(log(57, 3, 2, 1, 0), stop_alarm1 = 57)), [])
+
+    def testAlarmDatapoints(self):
+        magna = alarmDatapoints("magna")
+        self.assertEqual(magna[:5], list(ALARM_LOG))
+        self.assertNotIn('stop_alarm1_bak', magna)
+        self.assertIn('stop_alarm1_bak', alarmDatapoints("upe"))
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
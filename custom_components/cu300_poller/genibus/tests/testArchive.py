@@ -0,0 +1,108 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+
+import json
+import os
+import shutil
+import tempfile
+import unittest
+
+from genibus.linklayer.archive import ArchiveReader, compact_sessions, decode_block, encode_block, is_archive
+from genibus.linklayer.session import load_session
+
+REQUESTS = (
+    "2707200102c302101a901c",
+    "270e200102c2232527220a0b1e37a8",
+    "2705200104810231e0",
+)
+
+
+def makeSession(path, created, count, start=0):
+    with open(path, "w", encoding="utf-8") as fp:
+        fp.write(json.dumps({"version": 1, "created": created}) + "\n")
+        for idx in range(start, start + count):
+            request = REQUESTS[idx % len(REQUESTS)]
+            value = (1000 + idx // 10) & 0xffff
+            if idx % 97 == 0:
+                entry = {"rep": None, "error": "timeout", "rtt": 5.0}
+            else:
+                reply = bytes((0x24, 0x0e, 0x01, 0x20, 0x02, 0x04)) + value.to_bytes(2, "big") + bytes((0x39, 0x80, idx % 3, 0x02, 0xb5))
+                entry = {"rep": reply.hex(), "error": None, "rtt": 0.012 + (idx % 5) * 1e-4}
+            entry.update({"t": round((idx - start) * 0.5 + 0.001, 6), "da": 0x20, "req": request})
+            fp.write(json.dumps(entry) + "\n")
+
+
+class TestArchive(unittest.TestCase):
+
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+        self.first = os.path.join(self.directory, "first.jsonl")
+        self.second = os.path.join(self.directory, "second.jsonl")
+        self.archive = os.path.join(self.directory, "capture.gbar")
+        makeSession(self.first, 1700000000.0, 3000)
+        makeSession(self.second, 1700001500.0, 2000, start=3000)
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+
+    def testBlockRoundTrip(self):
+        transactions = load_session(self.first)[:200]
+        self.assertEqual(decode_block(encode_block(transactions, 0.0), 0.0), transactions)
+
+    def testCompactAndLoad(self):
+        stats = compact_sessions([self.first, self.second], self.archive, block_size=1000)
+        self.assertTrue(is_archive(self.archive))
+        self.assertFalse(is_archive(self.first))
+        self.assertEqual(stats["transactions"], 5000)
+        self.assertEqual(stats["blocks"], 5)
+        self.assertLess(stats["compressed"] * 20, stats["original"])
+        transactions = load_session(self.archive)
+        self.assertEqual(transactions[:3000], load_session(self.first))
+        second = load_session(self.second)
+        self.assertEqual([entry["rep"] for entry in transactions[3000:]], [entry["rep"] for entry in second])
+        self.assertAlmostEqual(transactions[3000]["t"], 1500.001)
+
+    def testSeek(self):
+        compact_sessions([self.first], self.archive, block_size=500)
+        reader = ArchiveReader(self.archive)
+        self.assertEqual(len(reader), 3000)
+        window = list(reader.transactions(start=1000.0, end=1010.0))
+        self.assertEqual(len(window), 20)
+        self.assertTrue(all(1000.0 <= entry["t"] <= 1010.0 for entry in window))
+        t, request, reply = next(reader.frames(start=1000.0))
+        self.assertEqual(request, bytes.fromhex(window[0]["req"]))
+        self.assertEqual(reply, bytes.fromhex(window[0]["rep"]))
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
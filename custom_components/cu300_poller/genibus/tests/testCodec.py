@@ -0,0 +1,86 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+import unittest
+
+from genibus import apdu
+from genibus import gbdefs as defs
+from genibus.codec import ReplyCodec
+from genibus.utils import crc
+
+
+def positiveReply(request, ack = defs.Acknowledge.OK, short = 0):
+    """Reply with value = index for every ID of every GET APDU in `request`."""
+    data = []
+    for klass, op, ids in apdu.splitAPDUs(request):
+        width = 2 if klass in apdu.SIXTEENBIT_CLASSES else 1
+        values = list(range(len(ids) * width - short))
+        data += [klass, (ack << 6) | len(values)] + values
+    return crc.append_tel(bytearray([0x24, len(data) + 2, 0x01, 0x20] + data))
+
+
+class TestCodec(unittest.TestCase):
+
+    def setUp(self):
+        self.header = apdu.Header(defs.FrameType.SD_DATA_REQUEST, 0x20, 0x01)
+
+    def testMatchesGenericDecoder(self):
+        names = [name for name in apdu.db.dataitemsByClass("magna", defs.APDUClass.MEASURED_DATA)]
+        names += [name for name in apdu.db.dataitemsByClass("magna", defs.APDUClass.CONFIGURATION_PARAMETERS)]
+        for telegram in apdu.createGetPDUs(self.header, names):
+            codec = ReplyCodec(telegram)
+            self.assertTrue(codec.compiled)
+            reply = positiveReply(telegram)
+            self.assertEqual(codec.decode(reply), apdu.decodeReply(telegram, reply))
+
+    def testFallbackOnNak(self):
+        telegram = apdu.createGetPDUs(self.header, ['h', 'q', 'unit_addr'])[0]
+        codec = ReplyCodec(telegram)
+        reply = positiveReply(telegram, ack = defs.Acknowledge.ID_UNKNOWN, short = 2)
+        self.assertEqual(codec.decode(reply), apdu.decodeReply(telegram, reply))
+        self.assertEqual(codec.decode(reply), {})
+
+    def testFallbackOnShortData(self):
+        telegram = apdu.createGetPDUs(self.header, ['h', 'q'])[0]
+        reply = positiveReply(telegram, short = 1)
+        self.assertEqual(ReplyCodec(telegram).decode(reply), {'h': 0})
+
+    def testStringsNotCompiled(self):
+        telegram = apdu.createGetPDUs(self.header, ['product_name'])[0]
+        codec = ReplyCodec(telegram)
+        self.assertFalse(codec.compiled)
+        reply = crc.append_tel(bytearray([0x24, 0x08, 0x01, 0x20, 0x07, 0x04]) + b'MGE\x00')
+        self.assertEqual(codec.decode(reply), {'product_name': 'MGE'})
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,95 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+import asyncio
+import unittest
+
+from genibus import gbdefs
+from genibus.apdu import Header, createCompoundPDU
+from genibus.exceptions import ProtocolError
+from genibus.linklayer.connection import Connection
+
+try:
+    from genibus.protocol import CU300Protocol
+except ImportError:     # pyserial not installed.
+    CU300Protocol = None
+
+
+class Unit(Connection):
+    """Answers every command telegram with `ack` for the SET and act_mode1 = 0 for the read-back."""
+
+    def __init__(self, ack):
+        super().__init__()
+        self.ack = ack
+
+    async def connect(self):
+        self._reader = asyncio.StreamReader()
+
+    async def disconnect(self):
+        pass
+
+    async def write(self, data):
+        header = Header(gbdefs.FrameType.SD_DATA_REPLY, data[gbdefs.SOURCE_ADDRESS], data[gbdefs.DESTINATION_ADRESS])
+        klass = data[gbdefs.PDU_START]
+        self._reader.feed_data(bytes(createCompoundPDU(header, [
+            bytearray((klass, self.ack << 6)),
+            bytearray((gbdefs.APDUClass.MEASURED_DATA, 0x01, 0x00)),
+        ])))
+
+    async def read(self, size=1):
+        return await self._reader.read(size)
+
+
+@unittest.skipIf(CU300Protocol is None, "pyserial not installed")
+class TestCommands(unittest.TestCase):
+
+    def run_command(self, ack, command, *args):
+        protocol = CU300Protocol("tcp")
+        protocol._connection = unit = Unit(ack)
+
+        async def run():
+            await unit.connect()
+            return await getattr(protocol, command)(*args)
+        return asyncio.run(run())
+
+    def testAcknowledged(self):
+        for command, args in (("start_pump", ()), ("stop_pump", ()), ("set_reference", (50, ))):
+            self.assertIsInstance(self.run_command(gbdefs.Acknowledge.OK, command, *args), dict)
+
+    def testRejected(self):
+        for command, args in (("start_pump", ()), ("stop_pump", ()), ("set_reference", (50, ))):
+            with self.assertRaisesRegex(ProtocolError, "OPERATION_ILLEGAL"):
+                self.run_command(gbdefs.Acknowledge.OPERATION_ILLEGAL, command, *args)
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
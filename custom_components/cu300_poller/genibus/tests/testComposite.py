@@ -0,0 +1,76 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+import unittest
+
+import genibus.gbdefs as defs
+import genibus.apdu as apdu
+from genibus.composite import CompositeDecoder, Layout
+
+COUNTER = {'energy': Layout(('energy_hi', 'energy_lo'), 8, True)}
+
+
+class TestComposite(unittest.TestCase):
+
+    def testPartsShareOneAPDU(self):
+        names = ['h', 'q', 'p', 't_w', 'v_dc', 't_m', 'energy']
+        apdus = apdu.createGetAPDUs(names, 7, "magna")
+        energy = (0x98, 0x99)
+        self.assertTrue(any(all(ident in a[2:] for ident in energy) for _, a in apdus))
+        for _, a in apdus:
+            self.assertLessEqual(len(a) - 2, 7)
+
+    def testLayout(self):
+        self.assertEqual(apdu.compositeLayout('speed', "magna"), Layout(('speed_hi', 'speed_lo'), 8, False))
+        # UPE has a plain 8-bit speed datapoint.
+        self.assertIsNone(apdu.compositeLayout('speed', "upe"))
+
+    def testCombine(self):
+        decoder = CompositeDecoder()
+        self.assertEqual(decoder.decode({'energy_hi': 0x12, 'energy_lo': 0x34}, COUNTER)['energy'], 0x1234)
+
+    def testTornReadSuppressed(self):
+        decoder = CompositeDecoder()
+        decoder.decode({'energy_hi': 0x01, 'energy_lo': 0xff}, COUNTER)
+        # Low byte wrapped after the high byte was latched.
+        self.assertNotIn('energy', decoder.decode({'energy_hi': 0x01, 'energy_lo': 0x00}, COUNTER))
+        self.assertEqual(decoder.decode({'energy_hi': 0x02, 'energy_lo': 0x00}, COUNTER)['energy'], 0x0200)
+
+    def testLargeJumpNeedsConfirmation(self):
+        decoder = CompositeDecoder()
+        decoder.decode({'energy_hi': 0x01, 'energy_lo': 0x00}, COUNTER)
+        self.assertNotIn('energy', decoder.decode({'energy_hi': 0x20, 'energy_lo': 0x00}, COUNTER))
+        self.assertEqual(decoder.decode({'energy_hi': 0x20, 'energy_lo': 0x01}, COUNTER)['energy'], 0x2001)
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
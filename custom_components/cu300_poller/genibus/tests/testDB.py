@@ -26,9 +26,14 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 """
 
-from genibus.devices.db import DeviceDB, DataitemByClass
+from genibus.devices.db import DeviceDB, DataitemByClass, CATALOG_DIR
 import genibus.gbdefs as defs
 
+import gc
+import json
+import os
+import shutil
+import tempfile
 import unittest
 
 class TestAPDUs(unittest.TestCase):
@@ -45,10 +50,62 @@ class TestAPDUs(unittest.TestCase):
              (5, 'Voltage', 5.0, 'V'),
              (104, 'Voltage', 2.0, 'V')])
 
+    def testResolveModel(self):
+        self.assertEqual(self.db.resolveModel(1, 7), "upe")
+        self.assertEqual(self.db.resolveModel(3, 1), "magna")
+        self.assertEqual(self.db.resolveModel(99, 1), "magna")
+        self.assertEqual(self.db.resolveModel(None, None), "magna")
+
     def testDataItemByClassName(self):
         self.assertEqual(self.db.dataitemByClassAndName("magna", "ref_loc"), DataitemByClass(40, 2, 1, 'Local reference setting'))
 
 
+class TestReload(unittest.TestCase):
+
+    def setUp(self):
+        self.db = DeviceDB()
+        self.directory = tempfile.mkdtemp()
+        for name in os.listdir(CATALOG_DIR):
+            if name.endswith('.json'):
+                shutil.copy(os.path.join(CATALOG_DIR, name), self.directory)
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+        self.db.reload()
+
+    def writeModel(self, model, rows):
+        with open(os.path.join(self.directory, model + '.json'), 'w') as fp:
+            json.dump(rows, fp)
+
+    def testReloadAddsModel(self):
+        old = self.db.catalog
+        self.writeModel('newpump', [["buf_len", 0, 2, 1, ""], ["speed", 2, 35, 1, "Pump speed"]])
+        version = self.db.reload(self.directory)
+        self.assertEqual(version, old.version + 1)
+        self.assertEqual(self.db.version, version)
+        self.assertEqual(self.db.dataitemByClassAndName("newpump", "speed"), DataitemByClass(35, 2, 1, 'Pump speed'))
+        # Readers still holding the old version keep a consistent view of it.
+        self.assertEqual(old.dataitemByClassAndName("newpump", "speed"), [])
+        self.assertIn(old.version, self.db.retired())
+        del old
+        gc.collect()
+        self.assertNotIn(version - 1, self.db.retired())
+
+    def testIdentityMapMustNameKnownModels(self):
+        path = os.path.join(self.directory, 'models.map')
+        with open(path, 'w') as fp:
+            json.dump({"families": {"5": {"*": "mp204"}}}, fp)
+        with self.assertRaises(ValueError):
+            self.db.loadCatalog(self.directory, modelsFile = path)
+
+    def testInvalidCatalogIsNotPublished(self):
+        version = self.db.version
+        self.writeModel('broken', [["speed", 2, 35, 1, ""], ["speed", 2, 36, 1, ""]])
+        with self.assertRaises(ValueError):
+            self.db.reload(self.directory)
+        self.assertEqual(self.db.version, version)
+
+
 def main():
     unittest.main()
 
@@ -0,0 +1,107 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+import unittest
+
+from genibus.datamanager.derived import DerivedEngine, Expression, WindowedIntegral, WindowedDelta, defaultMetrics, RHO, G
+
+
+class TestDerived(unittest.TestCase):
+
+    def testHydraulicPowerAndEfficiency(self):
+        engine = DerivedEngine()
+        result = engine.update(0.0, {'flow': 36.0, 'head': 10.0, 'power': 2000})
+        self.assertAlmostEqual(result['hydraulic_power'], RHO * G * 0.01 * 10.0)
+        self.assertAlmostEqual(result['efficiency'], 100.0 * RHO * G * 0.1 / 2000)
+
+    def testMissingInput(self):
+        engine = DerivedEngine()
+        result = engine.update(0.0, {'flow': 36.0})
+        self.assertIsNone(result['hydraulic_power'])
+        self.assertIsNone(result['efficiency'])
+
+    def testZeroPower(self):
+        result = DerivedEngine().update(0.0, {'flow': 36.0, 'head': 10.0, 'power': 0})
+        self.assertIsNone(result['efficiency'])
+
+    def testWindowedIntegral(self):
+        integral = WindowedIntegral('e', 'p', 3600.0)
+        self.assertEqual(integral.update(0.0, {'p': 1000.0}), 0.0)
+        self.assertAlmostEqual(integral.update(1800.0, {'p': 1000.0}), 500.0)
+        self.assertAlmostEqual(integral.update(3600.0, {'p': 1000.0}), 1000.0)
+        # The first half hour drops out of the window.
+        self.assertAlmostEqual(integral.update(5400.0, {'p': 0.0}), 750.0)
+
+    def testSpecificEnergy(self):
+        engine = DerivedEngine()
+        for t in range(0, 3601, 60):
+            result = engine.update(float(t), {'flow': 10.0, 'head': 20.0, 'power': 1000.0})
+        self.assertAlmostEqual(result['energy_window'], 1000.0)
+        self.assertAlmostEqual(result['volume_window'], 10.0)
+        self.assertAlmostEqual(result['specific_energy'], 0.1)
+
+    def testWindowedDelta(self):
+        delta = WindowedDelta('run', 't_2hour', 3600.0, 2.0)
+        self.assertEqual(delta.update(0.0, {'t_2hour': 100}), 0.0)
+        self.assertEqual(delta.update(1800.0, {'t_2hour': 101}), 2.0)
+        self.assertEqual(delta.update(3600.0, {'t_2hour': 101}), 2.0)
+        self.assertEqual(delta.update(7200.0, {'t_2hour': 102}), 2.0)
+
+    def testScales(self):
+        engine = DerivedEngine([Expression('double', ('x', ), lambda x: 2 * x)], scales = {'x': 0.5})
+        self.assertEqual(engine.update(0.0, {'x': 10})['double'], 10.0)
+
+    def testRequiredScales(self):
+        engine = DerivedEngine(requireScales = True)
+        # Raw bytes never make it into metrics with units.
+        result = engine.update(0.0, {'flow': 36, 'head': 100, 'power': 20})
+        self.assertIsNone(result['hydraulic_power'])
+        self.assertIsNone(result['energy_window'])
+        self.assertTrue(engine.setScale('flow', 1.0, 0.0, 'm³/h'))
+        self.assertTrue(engine.setScale('head', 0.1, 0.0, 'm'))
+        self.assertTrue(engine.setScale('power', 0.1, 0.0, 'kW'))
+        self.assertFalse(engine.setScale('head', 1.0, 0.0, 'bar'))
+        self.assertTrue(engine.setScale('head', 0.1, 0.0, 'm'))
+        result = engine.update(1.0, {'flow': 36, 'head': 100, 'power': 20})
+        self.assertAlmostEqual(result['hydraulic_power'], RHO * G * 0.01 * 10.0)
+        self.assertAlmostEqual(result['efficiency'], 100.0 * RHO * G * 0.1 / 2000)
+
+    def testRequires(self):
+        engine = DerivedEngine(defaultMetrics())
+        self.assertEqual(engine.requires('efficiency'), {'flow', 'head', 'power'})
+        self.assertEqual(engine.requires('specific_energy'), {'flow', 'power'})
+        self.assertEqual(engine.requires('run_time_window'), {'t_2hour'})
+        self.assertEqual(engine.inputs, {'flow', 'head', 'power', 't_2hour', 'energy'})
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,127 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+
+import asyncio
+import unittest
+
+from genibus.linklayer.fairshare import BusScheduler, client
+
+
+class Clock:
+
+    def __init__(self):
+        self.now = 0.0
+
+    def __call__(self):
+        return self.now
+
+
+def run(scheduler, clock, clients, transactions, concurrency = 4):
+    """Backlogged clients with `concurrency` requests each in flight, each client sending
+    telegrams of its own size; returns the order of service."""
+    order = []
+
+    async def worker(name, size):
+        with client(name):
+            while len(order) < transactions:
+                async with scheduler.slot():
+                    order.append(name)
+                    scheduler.charge(size)
+                    clock.now += scheduler.wire_time(size)
+                    await asyncio.sleep(0)
+
+    async def main():
+        # Stop at the first client that sees enough transactions; the others may
+        # still be waiting for their budget, which the frozen clock never refills.
+        tasks = [asyncio.ensure_future(worker(name, size)) for name, size in clients.items() for _ in range(concurrency)]
+        await asyncio.wait(tasks, return_when = asyncio.FIRST_COMPLETED)
+        for task in tasks:
+            task.cancel()
+        await asyncio.gather(*tasks, return_exceptions = True)
+
+    asyncio.run(main())
+    return order
+
+
+class TestFairShare(unittest.TestCase):
+
+    def setUp(self):
+        self.clock = Clock()
+        self.scheduler = BusScheduler(9600, clock = self.clock)
+
+    def share(self, name):
+        return self.scheduler.stats()[name]["share"]
+
+    def testWireTime(self):
+        self.assertAlmostEqual(self.scheduler.wire_time(96), 0.1)
+
+    def testEqualWeightsShareWireTime(self):
+        # 'bulk' asks for ten times the data per request, but only gets half the bus.
+        run(self.scheduler, self.clock, {"bulk": 200, "light": 20}, 400)
+        self.assertAlmostEqual(self.share("bulk"), 0.5, delta = 0.05)
+        self.assertGreater(self.scheduler.stats()["light"]["slots"], 5 * self.scheduler.stats()["bulk"]["slots"])
+
+    def testWeights(self):
+        self.scheduler.configure("scada", weight = 3)
+        run(self.scheduler, self.clock, {"scada": 50, "reports": 50}, 400)
+        self.assertAlmostEqual(self.share("scada"), 0.75, delta = 0.05)
+
+    def testBudgetCapsShare(self):
+        self.scheduler.configure("reports", budget = 0.1)
+        run(self.scheduler, self.clock, {"poll": 30, "reports": 100}, 600)
+        self.assertLess(self.share("reports"), 0.15)
+
+    def testInvalidShare(self):
+        with self.assertRaises(ValueError):
+            self.scheduler.configure("x", weight = 0)
+        with self.assertRaises(ValueError):
+            self.scheduler.configure("x", budget = 1.5)
+
+    def testCancelledWaiterLeavesQueue(self):
+        async def main():
+            await self.scheduler.acquire("a")
+            waiter = asyncio.ensure_future(self.scheduler.acquire("b"))
+            await asyncio.sleep(0)
+            waiter.cancel()
+            await asyncio.gather(waiter, return_exceptions = True)
+            self.scheduler.release()
+            await asyncio.wait_for(self.scheduler.acquire("c"), 1.0)
+            self.scheduler.release()
+
+        asyncio.run(main())
+        self.assertEqual(self.scheduler.stats()["b"]["slots"], 0)
+        self.assertEqual(self.scheduler.stats()["c"]["slots"], 1)
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
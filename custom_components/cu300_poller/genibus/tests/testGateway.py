@@ -0,0 +1,181 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+import asyncio
+import multiprocessing
+import os
+import unittest
+
+from genibus.gateway.table import ValueTable
+
+try:
+    from genibus.gateway import aggregator, worker
+    from genibus.gateway.aggregator import Aggregator, shard
+    from genibus.gateway.worker import PortConfig, Worker
+except ImportError:     # pyserial not installed.
+    shard = None
+
+
+class BuggyProtocol(object):
+    """Fails the first poll with an error outside the GENIBus ones."""
+
+    def __init__(self, **kws):
+        self.polls = 0
+        self.scheduler = None
+
+    def set_datapoints(self, datapoints):
+        pass
+
+    async def connect(self):
+        pass
+
+    async def disconnect(self):
+        pass
+
+    async def poll_data(self):
+        self.polls += 1
+        if self.polls == 1:
+            raise RuntimeError("bug")
+        return {'head': 1.0}
+
+
+class FakeTransport(object):
+
+    def __init__(self):
+        self.size = 0
+
+    def get_write_buffer_size(self):
+        return self.size
+
+
+class FakeWriter(object):
+
+    def __init__(self):
+        self.transport = FakeTransport()
+        self.lines = []
+
+    def is_closing(self):
+        return False
+
+    def write(self, data):
+        self.lines.append(data)
+
+
+class TestValueTable(unittest.TestCase):
+
+    def setUp(self):
+        self.table = ValueTable.create("cu300_test_{0}".format(os.getpid()), ['head', 'flow', 'product_name'])
+
+    def tearDown(self):
+        self.table.close()
+
+    def testEmpty(self):
+        self.assertEqual(self.table.read(), (0, {}))
+
+    def testWriteAndAttach(self):
+        worker = ValueTable.attach(self.table.name, self.table.names)
+        try:
+            self.assertEqual(worker.write({'head': 12, 'product_name': 'MAGNA', 'unknown': 1}), 2)
+            self.assertEqual(worker.write({'flow': 3.5}), 4)
+        finally:
+            worker.close()
+        self.assertEqual(self.table.read(), (4, {'head': 12.0, 'flow': 3.5}))
+
+
+@unittest.skipIf(shard is None, "pyserial not installed")
+class TestShard(unittest.TestCase):
+
+    def testRoundRobin(self):
+        ports = [PortConfig("p{0}".format(idx), "serial", "/dev/ttyS{0}".format(idx)) for idx in range(5)]
+        self.assertEqual([[port.id for port in group] for group in shard(ports, 2)], [['p0', 'p2', 'p4'], ['p1', 'p3']])
+        self.assertEqual(len(shard(ports[:1], 8)), 1)
+
+    def testPollSurvivesUnexpectedErrors(self):
+        port = PortConfig("p0", "serial", "/dev/ttyS0", interval = 0.05)
+        table = ValueTable.create("cu300_test_worker_{0}".format(os.getpid()), port.names)
+        ours, theirs = multiprocessing.Pipe()
+        original, worker.CU300Protocol = worker.CU300Protocol, BuggyProtocol
+
+        async def run():
+            poller = Worker([port], {port.id: table.name}, theirs)
+            task = asyncio.create_task(poller.run())
+            messages = []
+            while not any(message[0] == "update" for message in messages):
+                await asyncio.sleep(0.01)
+                while ours.poll():
+                    messages.append(ours.recv())
+            ours.send(("stop", ))
+            self.assertEqual(await task, 0)
+            return messages
+
+        try:
+            messages = asyncio.run(run())
+        finally:
+            worker.CU300Protocol = original
+            table.close()
+            ours.close()
+            theirs.close()
+        self.assertEqual(messages[0], ("error", "p0", "Unexpected error: bug"))
+        self.assertEqual(messages[-1][:2], ("update", "p0"))
+
+    def testSlowSubscriber(self):
+        port = PortConfig("p0", "serial", "/dev/ttyS0")
+        gateway = Aggregator([port], "/nonexistent", workers = 1)
+        table = gateway._tables["p0"] = ValueTable.create("cu300_test_agg_{0}".format(os.getpid()), port.names)
+        try:
+            writer = FakeWriter()
+            subscriber = aggregator._Subscriber(writer, None)
+            gateway._subscribers.add(subscriber)
+            writer.transport.size = aggregator.MAX_BUFFER + 1
+            table.write({'head': 1.0})
+            gateway._publish("p0")
+            table.write({'head': 2.0, 'flow': 3.0})
+            gateway._publish("p0")
+            self.assertEqual(writer.lines, [])
+            # Caught up: one resync with all values instead of the missed updates.
+            writer.transport.size = 0
+            table.write({'flow': 4.0})
+            gateway._publish("p0")
+            self.assertEqual(len(writer.lines), 1)
+            event = gateway._encode({"event": "update", "port": "p0", "seq": 6, "values": {'head': 2.0, 'flow': 4.0}, "resync": True})
+            self.assertEqual(writer.lines[0], event)
+        finally:
+            table.close()
+
+    def testLayout(self):
+        port = PortConfig("p0", "serial", "/dev/ttyS0", datapoints = ('energy', 'h'))
+        self.assertEqual(port.names[-1], 'energy')
+        self.assertEqual(port.names.count('head'), 1)
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
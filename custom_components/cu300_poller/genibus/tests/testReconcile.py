@@ -0,0 +1,116 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+import asyncio
+import unittest
+
+from genibus.reconcile import Reconciler, checkProfile, diffProfile, reconcileFleet
+
+
+class FakeUnit(object):
+    """Protocol stand-in keeping parameters in a dict; `sticky` values ignore writes."""
+
+    model = "magna"
+
+    def __init__(self, values, sticky = ()):
+        self.values = dict(values)
+        self.sticky = set(sticky)
+        self.writes = []
+        self.reads = []
+
+    async def read_datapoints(self, names):
+        self.reads.append(list(names))
+        return dict((name, self.values[name]) for name in names if name in self.values)
+
+    async def write_datapoints(self, values):
+        self.writes.append(dict(values))
+        for name, value in values.items():
+            if name not in self.sticky:
+                self.values[name] = value
+
+
+PROFILE = {'ref_steps': 5, 'h_const_ref_min': 0xf0, 'h_const_ref_max': 0x20}
+
+
+class TestReconcile(unittest.TestCase):
+
+    def testCheckProfile(self):
+        checkProfile(PROFILE, "magna")
+        with self.assertRaises(ValueError):
+            checkProfile({'h': 1}, "magna")
+        with self.assertRaises(ValueError):
+            checkProfile({'ref_steps': 256}, "magna")
+        with self.assertRaises(KeyError):
+            checkProfile({'no_such_datapoint': 1}, "magna")
+        for name in ('unit_addr', 'group_addr'):
+            with self.assertRaises(ValueError):
+                checkProfile({'ref_steps': 5, name: 0x20}, "magna")
+
+    def testDiff(self):
+        self.assertEqual([c.name for c in diffProfile(PROFILE, {'ref_steps': 5, 'h_const_ref_min': 0, 'h_const_ref_max': 0x20})], ['h_const_ref_min'])
+
+    def testWritesOnlyDifferences(self):
+        unit = FakeUnit({'ref_steps': 5, 'h_const_ref_min': 0, 'h_const_ref_max': 0x20})
+        result = asyncio.run(Reconciler(unit).reconcile(PROFILE))
+        self.assertEqual(unit.writes, [{'h_const_ref_min': 0xf0}])
+        self.assertEqual(result.failed, [])
+        self.assertEqual(asyncio.run(Reconciler(unit).reconcile(PROFILE)).changes, [])
+
+    def testDryRun(self):
+        unit = FakeUnit({'ref_steps': 1, 'h_const_ref_min': 0, 'h_const_ref_max': 0x20})
+        result = asyncio.run(Reconciler(unit).reconcile(PROFILE, dryRun = True))
+        self.assertEqual(len(result.changes), 2)
+        self.assertEqual(unit.writes, [])
+
+    def testVerifyFailure(self):
+        unit = FakeUnit({'ref_steps': 1, 'h_const_ref_min': 0xf0, 'h_const_ref_max': 0x20}, sticky = ['ref_steps'])
+        result = asyncio.run(Reconciler(unit).reconcile(PROFILE))
+        self.assertEqual(result.failed, ['ref_steps'])
+
+    def testWriteOnlyReferences(self):
+        unit = FakeUnit({})
+        reconciler = Reconciler(unit)
+        asyncio.run(reconciler.reconcile({'ref_rem': 100}))
+        self.assertEqual(unit.writes, [{'ref_rem': 100}])
+        self.assertEqual(unit.reads, [])
+        # The value written last stands in for the unreadable current one.
+        self.assertEqual(asyncio.run(reconciler.reconcile({'ref_rem': 100})).changes, [])
+
+    def testFleet(self):
+        units = [FakeUnit({'ref_steps': 5, 'h_const_ref_min': 0, 'h_const_ref_max': 0x20}), FakeUnit(dict(PROFILE))]
+        results = asyncio.run(reconcileFleet([Reconciler(unit) for unit in units], PROFILE))
+        self.assertEqual([len(result.changes) for result in results], [1, 0])
+        self.assertEqual(units[1].writes, [])
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,137 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+import asyncio
+import unittest
+
+from genibus.exceptions import CRCError
+from genibus.linklayer.connection import Connection
+from genibus.linklayer.retry import RetryPolicy
+
+try:
+    from genibus.protocol import CU300Protocol
+except ImportError:     # pyserial not installed.
+    CU300Protocol = None
+
+REQUEST = bytearray((0x27, 0x07, 0x20, 0x01, 0x02, 0xC3, 0x02, 0x10, 0x1A, 0x90, 0x1c))
+REPLY = bytes((0x24, 0x0e, 0x01, 0x20, 0x02, 0x04, 0x7a, 0x42, 0x39, 0x80, 0x04, 0x02, 0xb5, 0xc8, 0x03, 0x00, 0xf2, 0xd7))
+CORRUPTED = REPLY[:-1] + bytes((REPLY[-1] ^ 0xff, ))
+
+
+class NoisyBus(Connection):
+    """Answers with `bad` corrupted replies, each followed by `tail`, before the good one after `lead`."""
+
+    def __init__(self, bad, tail = b"", lead = b""):
+        super().__init__()
+        self.bad = bad
+        self.tail = tail
+        self.lead = lead
+        self.writes = 0
+
+    async def connect(self):
+        self._reader = asyncio.StreamReader()
+
+    async def disconnect(self):
+        pass
+
+    async def write(self, data):
+        self.writes += 1
+        self._reader.feed_data(CORRUPTED + self.tail if self.writes <= self.bad else self.lead + REPLY)
+
+    async def read(self, size=1):
+        return await self._reader.read(size)
+
+
+class Clock(object):
+
+    def __init__(self):
+        self.now = 0.0
+
+    def __call__(self):
+        return self.now
+
+
+class TestRetryPolicy(unittest.TestCase):
+
+    def testBackoff(self):
+        policy = RetryPolicy(retries = 3, gap = 0.01, backoff = 2.0, max_delay = 0.03)
+        self.assertEqual(policy.delay(0x20, 0), 0.01)
+        self.assertEqual(policy.delay(0x20, 1), 0.02)
+        self.assertEqual(policy.delay(0x20, 2), 0.03)
+        self.assertIsNone(policy.delay(0x20, 3))
+
+    def testBudget(self):
+        clock = Clock()
+        policy = RetryPolicy(budget = 2, refill = 0.5, clock = clock)
+        self.assertIsNotNone(policy.delay(0x20, 0))
+        self.assertIsNotNone(policy.delay(0x20, 0))
+        self.assertIsNone(policy.delay(0x20, 0))
+        # Other slaves have their own budget.
+        self.assertIsNotNone(policy.delay(0x21, 0))
+        clock.now = 2.0
+        self.assertIsNotNone(policy.delay(0x20, 0))
+        self.assertIsNone(policy.delay(0x20, 0))
+        self.assertEqual(policy.stats()[0x20]["retries"], 3)
+        self.assertEqual(policy.stats()[0x20]["exhausted"], 2)
+
+
+@unittest.skipIf(CU300Protocol is None, "pyserial not installed")
+class TestCRCRetry(unittest.TestCase):
+
+    def exchange(self, bus, policy):
+        protocol = CU300Protocol("tcp", retry_policy = policy)
+        protocol._connection = bus
+
+        async def run():
+            await bus.connect()
+            return await protocol._send_and_receive(REQUEST)
+        return asyncio.run(run())
+
+    def testRetrySucceeds(self):
+        bus = NoisyBus(1)
+        self.assertEqual(bytes(self.exchange(bus, RetryPolicy(gap = 0.0))), REPLY)
+        self.assertEqual(bus.writes, 2)
+
+    def testRetryResyncs(self):
+        # Trailing bytes of the bad reply are drained, noise before the good one is skipped.
+        bus = NoisyBus(1, tail = b"\x00\x24\x03", lead = b"\xff\x00")
+        self.assertEqual(bytes(self.exchange(bus, RetryPolicy(gap = 0.0))), REPLY)
+        self.assertEqual(bus.writes, 2)
+
+    def testRetriesExhausted(self):
+        bus = NoisyBus(3)
+        with self.assertRaises(CRCError):
+            self.exchange(bus, RetryPolicy(retries = 2, gap = 0.0))
+        self.assertEqual(bus.writes, 3)
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,111 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+import asyncio
+import os
+import tempfile
+import unittest
+
+from genibus.linklayer.connection import Connection
+from genibus.linklayer.session import RecordingConnection, ReplayConnection, load_session, summarize_session
+
+REQUEST = bytes((0x27, 0x07, 0x20, 0x01, 0x02, 0xC3, 0x02, 0x10, 0x1A, 0x90, 0x1c))
+REPLY = bytes((0x24, 0x0e, 0x01, 0x20, 0x02, 0x04, 0x7a, 0x42, 0x39, 0x80, 0x04, 0x02, 0xb5, 0xc8, 0x03, 0x00, 0xf2, 0xd7))
+
+
+class FakeBus(Connection):
+
+    async def connect(self):
+        self._reader = asyncio.StreamReader()
+
+    async def disconnect(self):
+        self._reader = None
+
+    async def write(self, data):
+        self._reader.feed_data(REPLY)
+
+    async def read(self, size=1):
+        return await self._reader.read(size)
+
+
+class TestSession(unittest.TestCase):
+
+    def setUp(self):
+        fd, self.path = tempfile.mkstemp(suffix=".jsonl")
+        os.close(fd)
+
+    def tearDown(self):
+        os.unlink(self.path)
+
+    def testRecordAndReplay(self):
+        async def record():
+            conn = RecordingConnection(FakeBus(), self.path)
+            await conn.connect()
+            await conn.write(REQUEST)
+            frame = await conn.read_frame()
+            await conn.disconnect()
+            return frame
+
+        async def replay():
+            conn = ReplayConnection(self.path, speed=100.0)
+            await conn.connect()
+            await conn.write(REQUEST)
+            frame = await asyncio.wait_for(conn.read_frame(), 1.0)
+            await conn.disconnect()
+            return frame
+
+        self.assertEqual(bytes(asyncio.run(record())), REPLY)
+        transactions = load_session(self.path)
+        self.assertEqual(len(transactions), 1)
+        self.assertEqual(transactions[0]["da"], 0x20)
+        self.assertEqual(summarize_session(transactions)[0x20]["count"], 1)
+        self.assertEqual(bytes(asyncio.run(replay())), REPLY)
+
+    def testReconnectAppendsSegment(self):
+        async def record():
+            conn = RecordingConnection(FakeBus(), self.path)
+            for _ in range(2):
+                await conn.connect()
+                await conn.write(REQUEST)
+                await conn.read_frame()
+                await conn.disconnect()
+
+        asyncio.run(record())
+        with open(self.path, encoding="utf-8") as fp:
+            self.assertEqual(sum('"version"' in line for line in fp), 2)
+        transactions = load_session(self.path)
+        self.assertEqual(len(transactions), 2)
+        self.assertLessEqual(transactions[0]["t"], transactions[1]["t"])
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,132 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+
+import os
+import tempfile
+import unittest
+
+from genibus.datamanager import snapshot
+from genibus.datamanager.snapshot import Snapshot
+
+
+class TestSnapshot(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmp.name, "values.snapshot")
+
+    def tearDown(self):
+        self.tmp.cleanup()
+
+    def testMissingFile(self):
+        self.assertIsNone(Snapshot(self.path).load())
+
+    def testGarbage(self):
+        with open(self.path, "wb") as fp:
+            fp.write(b"not a snapshot" * 100)
+        self.assertIsNone(Snapshot(self.path).load())
+        # A file that is not a snapshot is replaced on the first save.
+        writer = Snapshot(self.path)
+        writer.save({"h": 1.0})
+        writer.close()
+        self.assertEqual(Snapshot(self.path).load()[0], {"h": 1.0})
+
+    def testRoundTrip(self):
+        writer = Snapshot(self.path)
+        writer.save({"h": 1.5, "q": 2}, {"identity": {"unit_family": 3}})
+        writer.save({"h": 2.5, "q": 3})
+        values, meta, saved = Snapshot(self.path).load()
+        writer.close()
+        self.assertEqual(values, {"h": 2.5, "q": 3})
+        self.assertEqual(meta, {})
+        self.assertGreater(saved, 0)
+
+    def testWriteOnlyCopies(self):
+        writer = Snapshot(self.path)
+        payload = writer.encode({"h": 1.5})
+        self.assertFalse(writer.fits(payload))
+        with self.assertRaises(ValueError):
+            writer.write(payload)
+        writer.open()
+        self.assertTrue(writer.fits(payload))
+        writer.write(payload)
+        big = writer.encode({"x" * 10000: 1})
+        self.assertFalse(writer.fits(big))
+        writer.open(len(big))
+        writer.write(big)
+        writer.close()
+        self.assertEqual(Snapshot(self.path).load()[0], {"x" * 10000: 1})
+
+    def testNonJsonValuesAreSkipped(self):
+        writer = Snapshot(self.path)
+        writer.save({"h": 1.5, "product_name": "CU300", "log": object()}, {"identity": {"unit_family": 3}})
+        writer.close()
+        values, meta, _ = Snapshot(self.path).load()
+        self.assertEqual(values, {"h": 1.5, "product_name": "CU300"})
+        self.assertEqual(meta, {"identity": {"unit_family": 3}})
+
+    def testTornWriteFallsBack(self):
+        writer = Snapshot(self.path)
+        writer.save({"h": 1.0})
+        generation = writer.save({"h": 2.0})
+        writer.close()
+        # Corrupt the payload of the newest slot, as if the write was cut short.
+        offset = snapshot._HEADER.size + (generation & 1) * (snapshot._SLOT.size + snapshot.INITIAL_CAPACITY)
+        with open(self.path, "r+b") as fp:
+            fp.seek(offset + snapshot._SLOT.size)
+            fp.write(b"}")
+        self.assertEqual(Snapshot(self.path).load()[0], {"h": 1.0})
+
+    def testReopenKeepsCounting(self):
+        writer = Snapshot(self.path)
+        for value in range(5):
+            writer.save({"h": value})
+        writer.close()
+        # A restarted writer must not overwrite the newest slot with an older generation.
+        writer = Snapshot(self.path)
+        writer.save({"h": 10})
+        writer.close()
+        self.assertEqual(Snapshot(self.path).load()[0], {"h": 10})
+
+    def testGrows(self):
+        writer = Snapshot(self.path)
+        writer.save({"h": 1.0})
+        large = {f"dp{idx}": float(idx) for idx in range(1000)}
+        writer.save(large)
+        writer.close()
+        self.assertEqual(Snapshot(self.path).load()[0], large)
+        self.assertGreater(os.path.getsize(self.path), 2 * snapshot.INITIAL_CAPACITY)
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,77 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+import unittest
+
+from genibus.datamanager.static import StaticCache, isStatic
+
+
+class TestStaticCache(unittest.TestCase):
+
+    def testIsStatic(self):
+        self.assertTrue(isStatic("magna", "unit_addr"))
+        self.assertTrue(isStatic("magna", "product_name"))
+        self.assertFalse(isStatic("magna", "h"))
+        self.assertFalse(isStatic("magna", "no_such_datapoint"))
+
+    def testValidation(self):
+        cache = StaticCache()
+        self.assertEqual(cache.missing(['unit_addr', 'product_name']), ['product_name', 'unit_addr'])
+        cache.store(['unit_addr', 'product_name'], {'unit_addr': 0x20, 'product_name': 'MAGNA'})
+        self.assertEqual(cache.missing(['unit_addr', 'product_name']), [])
+        cache.invalidate(['unit_addr'])
+        self.assertEqual(cache.missing(['unit_addr', 'product_name']), ['unit_addr'])
+        cache.invalidate()
+        self.assertEqual(cache.missing(['product_name']), ['product_name'])
+        # Values stay available until re-read.
+        self.assertEqual(cache.values, {'unit_addr': 0x20, 'product_name': 'MAGNA'})
+
+    def testUnansweredDropped(self):
+        cache = StaticCache()
+        cache.store(['unit_addr'], {'unit_addr': 0x20})
+        cache.store(['unit_addr'], {})
+        self.assertEqual(cache.values, {})
+        self.assertEqual(cache.missing(['unit_addr']), [])
+
+    def testPersistence(self):
+        cache = StaticCache()
+        cache.store(['unit_addr'], {'unit_addr': 0x20})
+        restored = StaticCache()
+        restored.load(cache.dump())
+        self.assertEqual(restored.values, {'unit_addr': 0x20})
+        self.assertEqual(restored.missing(['unit_addr']), ['unit_addr'])
+        restored.load(None)
+        self.assertEqual(restored.values, {})
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,118 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+
+import unittest
+
+from genibus.datamanager.stats import StatsEngine, DEFAULT_METRICS, HIGH, LOW, NORMAL
+
+try:
+    from genibus.protocol import DATA_KEYS
+except ImportError:     # pyserial not installed.
+    DATA_KEYS = None
+
+
+class TestStats(unittest.TestCase):
+
+    def testEwma(self):
+        engine = StatsEngine([1, 2], metrics = ('p', 'i_mo'), alpha = 0.5)
+        engine.load(1, {'p': 100.0, 'i_mo': 2})
+        engine.sweep()
+        engine.load(1, {'p': 200.0})
+        engine.sweep()
+        stats = engine.stats(1, 'p')
+        self.assertEqual(stats.count, 2)
+        self.assertAlmostEqual(stats.mean, 150.0)
+        self.assertAlmostEqual(stats.variance, 0.5 * (0.5 * 100.0 ** 2))
+        self.assertEqual((stats.minimum, stats.maximum), (100.0, 200.0))
+        self.assertEqual(engine.stats(1, 'i_mo').count, 1)
+        self.assertIsNone(engine.stats(2, 'p'))
+        self.assertEqual(set(engine.snapshot(1)), {'p', 'i_mo'})
+
+    @unittest.skipIf(DATA_KEYS is None, "pyserial not installed")
+    def testDefaultMetricsMatchPolledData(self):
+        # Shaped like CU300Protocol.poll_data(): DATA_KEYS renamed, extra datapoints by their own name.
+        poll = {published: 10.0 + idx for idx, published in enumerate(DATA_KEYS.values())}
+        poll.update({'i_mo': 2.5, 't_m': 40.0, 'v_dc': 560.0})
+        engine = StatsEngine(['unit'])
+        engine.load('unit', poll)
+        engine.sweep()
+        self.assertEqual(set(engine.snapshot('unit')), set(DEFAULT_METRICS))
+        for name in ('power', 'head', 'flow'):
+            self.assertEqual(engine.stats('unit', name).mean, poll[name])
+
+    def testUnstagedStreamsAreSkipped(self):
+        engine = StatsEngine([1], metrics = ('p', ))
+        engine.load(1, {'p': 1.0})
+        engine.sweep()
+        engine.sweep()
+        self.assertEqual(engine.stats(1, 'p').count, 1)
+
+    def testZScoreEvent(self):
+        engine = StatsEngine(['a', 'b'], metrics = ('p', ), warmup = 10)
+        for idx in range(50):
+            engine.load('a', {'p': 100.0 + (idx % 2)})
+            engine.load('b', {'p': 100.0 + (idx % 2)})
+            self.assertEqual(engine.sweep(), [])
+        engine.load('b', {'p': 150.0})
+        events = engine.sweep()
+        self.assertEqual(len(events), 1)
+        self.assertEqual((events[0].slave, events[0].metric, events[0].kind, events[0].state), ('b', 'p', 'z', HIGH))
+        self.assertGreater(events[0].zscore, 4.0)
+        engine.load('b', {'p': 100.0})
+        self.assertEqual([event.state for event in engine.sweep()], [NORMAL])
+
+    def testLimitEvents(self):
+        engine = StatsEngine([1], metrics = ('t_m', ), limits = {'t_m': (None, 90.0)})
+        engine.load(1, {'t_m': 80.0})
+        self.assertEqual(engine.sweep(), [])
+        engine.load(1, {'t_m': 95.0})
+        events = engine.sweep()
+        self.assertEqual([(event.kind, event.state) for event in events], [('limit', HIGH)])
+        engine.load(1, {'t_m': 96.0})
+        self.assertEqual(engine.sweep(), [])
+        engine.load(1, {'t_m': 70.0})
+        self.assertEqual([(event.kind, event.state) for event in engine.sweep()], [('limit', NORMAL)])
+
+    def testLimitOnFirstSample(self):
+        engine = StatsEngine([1], metrics = ('t_m', ), limits = {'t_m': (10.0, 90.0)})
+        engine.load(1, {'t_m': 95.0})
+        events = engine.sweep()
+        self.assertEqual([(event.kind, event.state, event.value) for event in events], [('limit', HIGH, 95.0)])
+        self.assertEqual(engine.stats(1, 't_m').count, 1)
+        engine = StatsEngine([1], metrics = ('t_m', ), limits = {'t_m': (10.0, 90.0)})
+        engine.load(1, {'t_m': 5.0})
+        self.assertEqual([(event.kind, event.state) for event in engine.sweep()], [('limit', LOW)])
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
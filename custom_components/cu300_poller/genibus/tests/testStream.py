@@ -0,0 +1,140 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+
+import asyncio
+import json
+import math
+import os
+import tempfile
+import unittest
+
+from genibus.gateway import stream
+from genibus.gateway.stream import StreamServer, encode_values, decode_values, read_frame
+
+
+PORTS = {'p1': ['head', 'flow', 'speed'], 'p2': ['head', 'power']}
+
+
+class TestEncoding(unittest.TestCase):
+
+    def testRoundTrip(self):
+        values = {0: 12.0, 3: -4.0, 7: 0.25, 8: 1e300, 200: 0.0, 201: -2.0 ** 60}
+        self.assertEqual(decode_values(encode_values(values)), values)
+
+    def testIntegralValuesAreCompact(self):
+        # Count, then (id delta, zigzag value) per value: one byte each here.
+        self.assertEqual(encode_values({0: 1.0, 1: -1.0, 2: 3.0}), bytes([3, 0, 2, 2, 1, 2, 6]))
+
+    def testNaN(self):
+        self.assertTrue(math.isnan(decode_values(encode_values({1: float('nan')}))[1]))
+
+
+class TestStream(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.tmp.name, "stream.sock")
+
+    def tearDown(self):
+        self.tmp.cleanup()
+
+    def run_session(self, session, **kws):
+        async def main():
+            server = StreamServer(PORTS, **kws)
+            server.publish('p1', {'head': 10.0, 'flow': 1.0})
+            await server.start(socket=self.path)
+            reader, writer = await asyncio.open_unix_connection(self.path)
+            try:
+                await asyncio.wait_for(session(server, reader, writer), timeout=10)
+            finally:
+                writer.close()
+                await server.stop()
+            self.assertFalse(os.path.exists(self.path))
+        asyncio.run(main())
+
+    @staticmethod
+    async def subscribe(reader, writer, keys):
+        writer.write((json.dumps({'op': 'subscribe', 'keys': keys}) + "\n").encode())
+        await writer.drain()
+        return await read_frame(reader), await read_frame(reader)
+
+    @staticmethod
+    async def publish(server, port_id, values):
+        server.publish(port_id, values)
+        await asyncio.sleep(0)
+
+    def testSubscribeAndDeadband(self):
+        async def session(server, reader, writer):
+            keys, snapshot = await self.subscribe(reader, writer, [['p1', 'head', 0.5], ['p1', 'flow'], ['p2', '*', 0]])
+            self.assertEqual(keys, (stream.KEYS, 0, {'keys': [['p1', 'head'], ['p1', 'flow'], ['p2', 'head'], ['p2', 'power']]}))
+            self.assertEqual(snapshot, (stream.SNAPSHOT, 1, {0: 10.0, 1: 1.0}))
+            # Within the deadband of head, nothing to send.
+            await self.publish(server, 'p1', {'head': 10.4, 'flow': 1.0, 'speed': 50.0})
+            # Both ports in the same iteration: one batch.
+            server.publish('p1', {'head': 10.6, 'flow': 1.0})
+            server.publish('p2', {'head': 3.0, 'power': 120.5})
+            self.assertEqual(await read_frame(reader), (stream.DELTA, 2, {0: 10.6, 2: 3.0, 3: 120.5}))
+            await self.publish(server, 'p1', {'head': 10.6, 'flow': 1.25})
+            self.assertEqual(await read_frame(reader), (stream.DELTA, 3, {1: 1.25}))
+            self.assertEqual(server.subscribers, 1)
+        self.run_session(session)
+
+    def testErrorsKeepTheSubscription(self):
+        async def session(server, reader, writer):
+            await self.subscribe(reader, writer, [['p1', 'flow', 0]])
+            writer.write(b'{"op": "subscribe", "keys": [["p1", "torque", 0]]}\n')
+            kind, seq, content = await read_frame(reader)
+            self.assertEqual((kind, seq), (stream.ERROR, 2))
+            self.assertIn("torque", content['error'])
+            writer.write(b'{"op": "subscribe", "keys": [["p3", "head", 0]]}\n{"op": "unsubscribe"}\n')
+            self.assertEqual((await read_frame(reader))[0], stream.ERROR)
+            self.assertEqual((await read_frame(reader))[0], stream.ERROR)
+            await self.publish(server, 'p1', {'flow': 2.0})
+            self.assertEqual(await read_frame(reader), (stream.DELTA, 5, {0: 2.0}))
+        self.run_session(session)
+
+    def testSlowSubscriberResyncs(self):
+        async def session(server, reader, writer):
+            await self.subscribe(reader, writer, [['p1', 'head', 0]])
+            server._max_buffer = -1
+            await self.publish(server, 'p1', {'head': 11.0})
+            await self.publish(server, 'p1', {'head': 12.0})
+            server._max_buffer = stream.MAX_BUFFER
+            await self.publish(server, 'p1', {'head': 12.0})
+            # Frames 2 and 3 were dropped; the gap is followed by a snapshot.
+            self.assertEqual(await read_frame(reader), (stream.SNAPSHOT, 4, {0: 12.0}))
+        self.run_session(session)
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
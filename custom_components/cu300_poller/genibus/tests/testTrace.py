@@ -0,0 +1,67 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+__version__ = "0.1.0"
+
+__copyright__ = """
+Grundfos GENIBus Library.
+
+(C) 2007-2017 by Christoph Schueler <github.com/Christoph2,
+                                     cpu12.gems@googlemail.com>
+
+ All Rights Reserved
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+"""
+
+
+import json
+import os
+import tempfile
+import unittest
+
+from genibus.utils.trace import Tracer
+
+
+class TestTracer(unittest.TestCase):
+
+    def testTransactionPropagates(self):
+        tracer = Tracer()
+        with tracer.transaction("set_reference", reference=42) as txn:
+            with tracer.span("send_and_receive"):
+                tracer.instant("tx", length=10)
+        with tracer.span("outside"):
+            pass
+        fd, path = tempfile.mkstemp(suffix=".json")
+        os.close(fd)
+        try:
+            self.assertEqual(tracer.export(path), 4)
+            with open(path) as fp:
+                events = {e["name"]: e for e in json.load(fp)["traceEvents"]}
+        finally:
+            os.unlink(path)
+        self.assertEqual(events["set_reference"]["tid"], txn)
+        self.assertEqual(events["send_and_receive"]["tid"], txn)
+        self.assertEqual(events["tx"]["tid"], txn)
+        self.assertEqual(events["outside"]["tid"], 0)
+        self.assertEqual(events["set_reference"]["args"], {"reference": 42})
+        self.assertGreaterEqual(events["set_reference"]["dur"], events["send_and_receive"]["dur"])
+
+
+def main():
+    unittest.main()
+
+if __name__ == '__main__':
+    main()
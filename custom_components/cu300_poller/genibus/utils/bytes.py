@@ -45,4 +45,32 @@ def makeArray(buf):
     return tuple([x for x in buf])
 
 def dumpHex(arr):
-    return [hex(x) for x in arr]
\ No newline at end of file
+    return [hex(x) for x in arr]
+##
+## LEB128 varints, as used by the session archive and the value stream.
+##
+
+def putVarint(out, value):
+    """Append unsigned `value` to bytearray `out`."""
+    while value > 0x7f:
+        out.append((value & 0x7f) | 0x80)
+        value >>= 7
+    out.append(value)
+
+def getVarint(data, pos):
+    """(value, position after it) of the varint at `pos`."""
+    result = shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        result |= (byte & 0x7f) << shift
+        if not byte & 0x80:
+            return result, pos
+        shift += 7
+
+def zigzag(value):
+    """Signed to unsigned, small magnitudes staying small (64-bit range)."""
+    return (value << 1) ^ (value >> 63)
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
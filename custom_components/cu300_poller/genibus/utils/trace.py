@@ -0,0 +1,101 @@
+"""Lightweight span tracing, exported in Chrome trace-event format.
+
+A transaction (e.g. one Home Assistant service call) gets an ID that is
+carried through `contextvars`, so every span opened further down the call
+chain -- lock wait, send/receive, TX/RX of the wire frames -- ends up in the
+same row of chrome://tracing or Perfetto.
+
+    with tracer.transaction("set_reference", reference=42):
+        ...
+        with tracer.span("send_and_receive"):
+            ...
+            tracer.instant("tx", length=len(pdu))
+
+Spans are kept in a bounded ring buffer and written out by `export()`.
+"""
+import contextlib
+import contextvars
+import itertools
+import json
+import os
+import threading
+import time
+from collections import deque
+
+DEFAULT_CAPACITY = 20000
+
+_transaction = contextvars.ContextVar("genibus_transaction", default=0)
+
+
+class Tracer:
+
+    def __init__(self, capacity=DEFAULT_CAPACITY):
+        self.enabled = True
+        self._events = deque(maxlen=capacity)
+        self._ids = itertools.count(1)
+        self._pid = os.getpid()
+        self._lock = threading.Lock()
+
+    @staticmethod
+    def _now():
+        return time.perf_counter_ns() // 1000
+
+    @staticmethod
+    def current():
+        """ID of the transaction the caller is running in (0 = none)."""
+        return _transaction.get()
+
+    @contextlib.contextmanager
+    def transaction(self, name, **args):
+        """Start a new transaction and run the body as its root span."""
+        txn = next(self._ids)
+        token = _transaction.set(txn)
+        try:
+            with self.span(name, cat="transaction", **args):
+                yield txn
+        finally:
+            _transaction.reset(token)
+
+    @contextlib.contextmanager
+    def span(self, name, cat="genibus", **args):
+        if not self.enabled:
+            yield
+            return
+        start = self._now()
+        try:
+            yield
+        finally:
+            self._append({
+                "name": name, "cat": cat, "ph": "X",
+                "ts": start, "dur": self._now() - start,
+                "pid": self._pid, "tid": _transaction.get(),
+                "args": args,
+            })
+
+    def instant(self, name, cat="wire", **args):
+        if self.enabled:
+            self._append({
+                "name": name, "cat": cat, "ph": "i", "s": "t",
+                "ts": self._now(),
+                "pid": self._pid, "tid": _transaction.get(),
+                "args": args,
+            })
+
+    def _append(self, event):
+        with self._lock:
+            self._events.append(event)
+
+    def clear(self):
+        with self._lock:
+            self._events.clear()
+
+    def export(self, path):
+        """Write all buffered events to `path` as a Chrome trace-event JSON file."""
+        with self._lock:
+            events = list(self._events)
+        with open(path, "w", encoding="utf-8") as fp:
+            json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, fp)
+        return len(events)
+
+
+tracer = Tracer()
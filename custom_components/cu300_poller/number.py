@@ -72,7 +72,7 @@ class CU300ReferenceNumber(CoordinatorEntity[CU300Coordinator], NumberEntity):
     @property
     def available(self) -> bool:
         """Return if entity is available."""
-        return self.coordinator.last_update_success and self.coordinator.connected
+        return self.coordinator.available
 
     async def async_set_native_value(self, value: float) -> None:
         """Set new value."""
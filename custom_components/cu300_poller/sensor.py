@@ -21,6 +21,10 @@ from homeassistant.helpers.update_coordinator import CoordinatorEntity
 
 from .const import DOMAIN
 from .coordinator import CU300Coordinator
+from .genibus import gbdefs
+from .genibus.apdu import compositeLayout
+from .genibus.composite import COMPOSITES
+from .genibus.protocol import DATA_KEYS, EMBEDDED_PREFIX
 
 _LOGGER = logging.getLogger(__name__)
 
@@ -77,6 +81,15 @@ SENSOR_TYPES = [
 ]
 
 
+# Catalog classes exposed as (disabled by default) datapoint sensors.
+CATALOG_CLASSES = (
+    gbdefs.APDUClass.MEASURED_DATA,
+    gbdefs.APDUClass.CONFIGURATION_PARAMETERS,
+    gbdefs.APDUClass.REFERENCE_VALUES,
+    gbdefs.APDUClass.ASCII_STRINGS,
+)
+
+
 async def async_setup_entry(
     hass: HomeAssistant,
     entry: ConfigEntry,
@@ -85,15 +98,57 @@ async def async_setup_entry(
     """Set up CU300 sensor platform."""
     coordinator: CU300Coordinator = hass.data[DOMAIN][entry.entry_id]
 
-    entities = [
+    entities: list[SensorEntity] = [
         CU300Sensor(coordinator, entry, sensor_config)
         for sensor_config in SENSOR_TYPES
     ]
 
+    # The same values of the unit behind the CU300, if one is configured.
+    embedded = set(coordinator.embedded_keys.values())
+    for sensor_config in SENSOR_TYPES:
+        key = f"{EMBEDDED_PREFIX}{sensor_config['key']}"
+        if key in embedded:
+            entities.append(CU300Sensor(
+                coordinator, entry, {**sensor_config, "key": key, "name": f"Embedded {sensor_config['name']}"}
+            ))
+
+    # Every other readable datapoint of the catalog; these are polled only while enabled.
+    for _, name, klass, _, access, note in coordinator.protocol.catalog():
+        if klass not in CATALOG_CLASSES or access == gbdefs.Access.WO or name in DATA_KEYS:
+            continue
+        entities.append(CU300DatapointSensor(coordinator, entry, name, klass, note))
+
+    # Values assembled from hi/lo parts.
+    for name, composite in COMPOSITES.items():
+        if name in DATA_KEYS or not compositeLayout(name, coordinator.protocol.model):
+            continue
+        entities.append(CU300DatapointSensor(
+            coordinator, entry, name, gbdefs.APDUClass.MEASURED_DATA, composite.note
+        ))
+
+    # Metrics computed from the polled values.
+    for metric in coordinator.derived.metrics:
+        entities.append(CU300DerivedSensor(coordinator, entry, metric.name, metric.unit))
+
     async_add_entities(entities)
     _LOGGER.debug("Added %d CU300 sensors", len(entities))
 
 
+def _device_info(entry: ConfigEntry) -> dict[str, Any]:
+    return {
+        "identifiers": {(DOMAIN, entry.entry_id)},
+        "name": "Grundfos CU300",
+        "manufacturer": "Grundfos",
+        "model": "CU300",
+        "sw_version": "1.0",
+    }
+
+
+def _stale_attributes(coordinator: CU300Coordinator) -> dict[str, Any]:
+    """Flag values of the previous run that are shown until the first poll."""
+    return {"stale": True} if coordinator.stale else {}
+
+
 class CU300Sensor(CoordinatorEntity[CU300Coordinator], SensorEntity):
     """Representation of a CU300 sensor."""
 
@@ -114,13 +169,7 @@ class CU300Sensor(CoordinatorEntity[CU300Coordinator], SensorEntity):
         self._attr_state_class = sensor_config["state_class"]
         
         # Device info for grouping entities
-        self._attr_device_info = {
-            "identifiers": {(DOMAIN, entry.entry_id)},
-            "name": "Grundfos CU300",
-            "manufacturer": "Grundfos",
-            "model": "CU300",
-            "sw_version": "1.0",
-        }
+        self._attr_device_info = _device_info(entry)
 
     @property
     def native_value(self) -> Any:
@@ -132,16 +181,15 @@ class CU300Sensor(CoordinatorEntity[CU300Coordinator], SensorEntity):
     @property
     def available(self) -> bool:
         """Return if entity is available."""
-        return self.coordinator.last_update_success and self.coordinator.connected
+        return self.coordinator.available
 
     @property
     def extra_state_attributes(self) -> dict[str, Any] | None:
         """Return additional state attributes."""
+        attributes = _stale_attributes(self.coordinator)
         if self._key == "alarm_code" and self.native_value:
-            return {
-                "alarm_description": self._get_alarm_description(self.native_value)
-            }
-        return None
+            attributes["alarm_description"] = self._get_alarm_description(self.native_value)
+        return attributes or None
 
     def _get_alarm_description(self, code: int) -> str:
         """Get human-readable alarm description."""
@@ -155,3 +203,98 @@ class CU300Sensor(CoordinatorEntity[CU300Coordinator], SensorEntity):
             5: "Communication error",
         }
         return alarm_map.get(code, f"Unknown alarm code: {code}")
+
+
+class CU300DatapointSensor(CoordinatorEntity[CU300Coordinator], SensorEntity):
+    """Raw value of a catalog datapoint, polled only while the entity is enabled."""
+
+    _attr_entity_registry_enabled_default = False
+
+    def __init__(
+        self,
+        coordinator: CU300Coordinator,
+        entry: ConfigEntry,
+        name: str,
+        klass: int,
+        note: str | None,
+    ) -> None:
+        """Initialize the sensor."""
+        super().__init__(coordinator)
+        self._key = name
+        self._attr_name = f"CU300 {note or name}"
+        self._attr_unique_id = f"{entry.entry_id}_dp_{name}"
+        self._attr_icon = "mdi:database-eye"
+        self._attr_device_info = _device_info(entry)
+        self._attributes = {
+            "datapoint": name,
+            "class": gbdefs.NICE_CLASS_NAMES.get(klass, klass),
+        }
+
+    async def async_added_to_hass(self) -> None:
+        """Start polling the datapoint once the entity is enabled."""
+        await super().async_added_to_hass()
+        self.async_on_remove(self.coordinator.async_register_datapoint(self._key))
+
+    @property
+    def native_value(self) -> Any:
+        """Return the state of the sensor."""
+        if self.coordinator.data is None:
+            return None
+        return self.coordinator.data.get(self._key)
+
+    @property
+    def available(self) -> bool:
+        """Return if entity is available."""
+        return self.coordinator.available
+
+    @property
+    def extra_state_attributes(self) -> dict[str, Any]:
+        """Return additional state attributes."""
+        return {**self._attributes, **_stale_attributes(self.coordinator)}
+
+
+class CU300DerivedSensor(CoordinatorEntity[CU300Coordinator], SensorEntity):
+    """Metric derived from polled values (see genibus.datamanager.derived)."""
+
+    _attr_entity_registry_enabled_default = False
+    _attr_state_class = SensorStateClass.MEASUREMENT
+
+    def __init__(
+        self,
+        coordinator: CU300Coordinator,
+        entry: ConfigEntry,
+        name: str,
+        unit: str | None,
+    ) -> None:
+        """Initialize the sensor."""
+        super().__init__(coordinator)
+        self._key = name
+        self._attr_name = f"CU300 {name.replace('_', ' ').capitalize()}"
+        self._attr_unique_id = f"{entry.entry_id}_derived_{name}"
+        self._attr_icon = "mdi:function-variant"
+        self._attr_native_unit_of_measurement = unit
+        self._attr_device_info = _device_info(entry)
+
+    async def async_added_to_hass(self) -> None:
+        """Poll the inputs not already part of the default data set."""
+        await super().async_added_to_hass()
+        for name in self.coordinator.derived.requires(self._key):
+            if name not in DATA_KEYS.values():
+                self.async_on_remove(self.coordinator.async_register_datapoint(name))
+
+    @property
+    def native_value(self) -> Any:
+        """Return the state of the sensor."""
+        if self.coordinator.data is None:
+            return None
+        return self.coordinator.data.get(self._key)
+
+    @property
+    def available(self) -> bool:
+        """Return if entity is available."""
+        return self.coordinator.available
+
+    @property
+    def extra_state_attributes(self) -> dict[str, Any] | None:
+        """Return additional state attributes."""
+        return _stale_attributes(self.coordinator) or None
@@ -70,7 +70,7 @@ class CU300PumpSwitch(CoordinatorEntity[CU300Coordinator], SwitchEntity):
     @property
     def available(self) -> bool:
         """Return if entity is available."""
-        return self.coordinator.last_update_success and self.coordinator.connected
+        return self.coordinator.available
 
     async def async_turn_on(self, **kwargs: Any) -> None:
         """Turn the pump on."""